@@ -22,6 +22,23 @@ Purpose:
 #include <string>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <io.h>        // _setmode for binary output on stdout
+#include <fcntl.h>
 #include <windows.h>   // Used to change console text color (Windows only)
 
 using namespace std;
@@ -29,10 +46,12 @@ using namespace std;
 
 // ========================== CONSTANTS =====================================
 
-// Macro ratios as percentages of daily calories
-const double PROTEIN_PERCENT = 0.30;
-const double CARB_PERCENT = 0.40;
-const double FAT_PERCENT = 0.30;
+// Macro ratios of daily calories in basis points (3000 = 30 percent), so
+// all macro math is done in integers and gives the same result everywhere
+const int BASIS_POINTS_PER_WHOLE = 10000;
+const int PROTEIN_BASIS_POINTS = 3000;
+const int CARB_BASIS_POINTS = 4000;
+const int FAT_BASIS_POINTS = 3000;
 
 // Calories per gram for each macro
 const int CALORIES_PER_GRAM_PROTEIN = 4;
@@ -43,8 +62,8 @@ const int CALORIES_PER_GRAM_FAT = 9;
 const int NUMBER_OF_DAYS = 7;
 
 // Activity thresholds (hours per week)
-const double ACTIVITY_HIGH = 5.0;
-const double ACTIVITY_MEDIUM = 3.0;
+constexpr double ACTIVITY_HIGH = 5.0;
+constexpr double ACTIVITY_MEDIUM = 3.0;
 
 // Calorie thresholds (per day)
 const int CAL_EXCESS = 2500;
@@ -62,6 +81,18 @@ const int MEALS_PER_WEEK_HIGH = MEALS_PER_DAY_HIGH * NUMBER_OF_DAYS;
 const int MEALS_PER_WEEK_MEDIUM = MEALS_PER_DAY_MEDIUM * NUMBER_OF_DAYS;
 const int MEALS_PER_WEEK_LOW = MEALS_PER_DAY_LOW * NUMBER_OF_DAYS;
 
+// The default policy has to be one the sweep grid file would accept
+static_assert(PROTEIN_BASIS_POINTS >= 0 && CARB_BASIS_POINTS >= 0 && FAT_BASIS_POINTS >= 0,
+    "Macro ratios cannot be negative");
+static_assert(PROTEIN_BASIS_POINTS + CARB_BASIS_POINTS + FAT_BASIS_POINTS <= BASIS_POINTS_PER_WHOLE,
+    "Macro ratios cannot add up to more than 100 percent");
+static_assert(ACTIVITY_MEDIUM >= 0.0 && ACTIVITY_MEDIUM <= ACTIVITY_HIGH,
+    "Activity thresholds must be in order");
+static_assert(CAL_LOW >= 0 && CAL_LOW <= CAL_MEDIUM && CAL_MEDIUM <= CAL_HIGH && CAL_HIGH <= CAL_EXCESS,
+    "Calorie thresholds must be in order");
+static_assert(MEALS_PER_DAY_LOW > 0 && MEALS_PER_DAY_LOW <= MEALS_PER_DAY_MEDIUM &&
+    MEALS_PER_DAY_MEDIUM <= MEALS_PER_DAY_HIGH, "Meal frequency thresholds must be in order");
+
 // Console and formatting constants
 const int CONSOLE_WIDTH = 75;
 const int INPUT_IGNORE_LIMIT = 1000;
@@ -73,18 +104,461 @@ const int COLOR_SUB_HEADING = 2;   // Green
 const int COLOR_RECIPE = 14;  // Yellow
 const int COLOR_ERROR = 12;  // Red
 
+// Batch input constants
+const char PROFILE_FIELD_DELIMITER = '|';
+
+// Calorie entry ingestion (ring capacity must be a power of two)
+const int INGEST_RING_CAPACITY = 65536;
+const int INGEST_BATCH_SIZE = 256;
+const int CACHE_LINE_BYTES = 64;
+const int DAY_CALORIES_LIMIT = INT_MAX;   // Logged day totals are capped here
+
+// Rendered output cache
+const size_t RENDER_CACHE_BYTE_LIMIT = 4 * 1024 * 1024;
+const char   COLOR_MARKER = '\x01';    // Followed by one byte holding a color code
+
+// Report files
+const string REPORT_FILE_NAME = "report.txt";
+const string REPORT_INDEX_EXTENSION = ".idx";
+const string REPORT_INDEX_MAGIC = "VNWIDX2";
+const string REPORT_LINE_ENDING = "\r\n";   // Reports are Windows text files
+const string TEMP_FILE_EXTENSION = ".tmp";
+
+// Streaming export
+const int  EXPORT_BUFFER_SIZE = 1 << 16;
+const int  EXPORT_NAME_BYTES = 32;        // Fixed text field width in binary records
+const int  EXPORT_INT_FIELD_COUNT = 16;
+const int  EXPORT_RECORD_BYTES = 2 * EXPORT_NAME_BYTES + 4 * EXPORT_INT_FIELD_COUNT;
+const char EXPORT_BINARY_MAGIC[8] = {'V', 'N', 'W', 'E', 'X', 'P', '1', '\0'};
+
+// Weight projection (Monte Carlo)
+const int    PROJECTION_WEEKS = 24;
+const int    PROJECTION_TABLE_INTERVAL = 4;     // Weeks between rows of the table
+const int    PROJECTION_SIMULATIONS = 10000;
+const int    PROJECTION_LANES = 16;             // Simulations stepped together in the inner loops
+const int    FAT_LOSS_DEFICIT = 500;            // Assumed calories below maintenance
+const int    MUSCLE_GAIN_SURPLUS = 300;         // Assumed calories above maintenance
+const double CALORIES_PER_POUND = 3500.0;
+const double CALORIES_PER_LIFTING_HOUR = 250.0;
+const double WORKOUT_HOURS_VARIATION = 0.25;    // Week-to-week spread in training time
+const double PROJECTION_LOW_PERCENTILE = 0.10;
+const double PROJECTION_HIGH_PERCENTILE = 0.90;
+const unsigned long long PROJECTION_SEED = 0x5EED2530ULL;
+
+// Session recordings
+const string SESSION_RECORDING_MAGIC = "VNWREC1";
+const string RECORDED_REPORT_EXTENSION = ".report.txt";   // Report saved next to a recording
+
+// Policy sweep (members evaluated together against every grid point)
+const int SWEEP_MEMBER_BLOCK = 4096;
+
+// Memory-mapped snapshot files
+const char SNAPSHOT_MAGIC[8] = {'V', 'N', 'W', 'S', 'N', 'P', '3', '\0'};
+const uint64_t SNAPSHOT_VIEW_ALIGNMENT = 65536;      // Windows allocation granularity
+const uint64_t SNAPSHOT_VIEW_BYTES = 256 * 1024;     // Smallest window mapped at a time
+
+// Sharded batch runs (one worker process per shard)
+const int    SHARD_COUNT_LIMIT = 256;
+const int    SHARD_ATTEMPT_LIMIT = 3;      // Runs of a failing shard before giving up
+const int    SHARD_EXIT_INVALID_INPUT = 2; // Worker exit code for bad members (not retried)
+const string SHARD_INPUT_EXTENSION = ".in";
+const string SHARD_OUTPUT_EXTENSION = ".csv";
+const string SHARD_CHECKPOINT_EXTENSION = ".done";
+const string COHORT_STATS_EXTENSION = ".stats.csv";
+
+// Console colors are switched off while recorded sessions are replayed
+bool consoleColorsEnabled = true;
+
+// Menu option 2 writes here; replays point it at a scratch file so the
+// user's report is left alone
+string activeReportFileName = REPORT_FILE_NAME;
+
 
 // ============================ ENUM TYPE ===================================
 // Goal type for the lifter
 enum GoalType {FAT_LOSS, MAINTENANCE, MUSCLE_GAIN};
 
+// Sections of the report, in the order they appear in the file
+enum ReportSection {REPORT_INPUTS, REPORT_WEEKLY_MACROS, REPORT_DAILY_MACROS,
+    REPORT_PER_MEAL, REPORT_FOOTER, REPORT_SECTION_COUNT};
+
+// Output formats for the streaming export
+enum ExportFormat {EXPORT_CSV, EXPORT_JSON_LINES, EXPORT_BINARY};
+
+// Feedback given by menu option 3, in the order the checks are made
+enum NutritionOutcome {NUTRITION_SUFFICIENT, NUTRITION_DECENT,
+    NUTRITION_UNDER_FUELING, NUTRITION_EXCESS, NUTRITION_BALANCED,
+    NUTRITION_OUTCOME_COUNT};
+enum MealFrequencyOutcome {MEAL_FREQUENCY_EXCELLENT, MEAL_FREQUENCY_TOO_LOW,
+    MEAL_FREQUENCY_TOO_HIGH, MEAL_FREQUENCY_APPROPRIATE,
+    MEAL_FREQUENCY_OUTCOME_COUNT};
+
+
+// =========================== STRUCT TYPES =================================
+
+// Macro ratios and the calorie and activity thresholds used for feedback.
+// The program uses DEFAULT_MACRO_POLICY; the sweep mode tries alternatives.
+struct MacroPolicy
+{
+    int    proteinBasisPoints;
+    int    carbBasisPoints;
+    int    fatBasisPoints;
+    double activityHigh;
+    double activityMedium;
+    int    calExcess;
+    int    calHigh;
+    int    calMedium;
+    int    calLow;
+};
+
+const MacroPolicy DEFAULT_MACRO_POLICY = {PROTEIN_BASIS_POINTS,
+    CARB_BASIS_POINTS, FAT_BASIS_POINTS, ACTIVITY_HIGH, ACTIVITY_MEDIUM,
+    CAL_EXCESS, CAL_HIGH, CAL_MEDIUM, CAL_LOW};
+
+// The member inputs the sweep needs, packed so a block stays in cache
+// while it is evaluated against every grid point
+struct SweepMember
+{
+    int    dailyCalories;
+    int    mealsPerDay;
+    double weeklyWorkoutHours;
+};
+
+// Population totals for one sweep grid point
+struct SweepTotals
+{
+    long long dailyProteinGrams;
+    long long dailyCarbGrams;
+    long long dailyFatGrams;
+    long long proteinPerMeal;
+    long long carbsPerMeal;
+    long long fatsPerMeal;
+    long long nutritionOutcomes[NUTRITION_OUTCOME_COUNT];
+    long long mealFrequencyOutcomes[MEAL_FREQUENCY_OUTCOME_COUNT];
+};
+
+// One member's inputs and weekly calorie log (used by the batch modes)
+struct MemberProfile
+{
+    string   name;
+    string   favoriteProtein;
+    int      dailyCalories;
+    int      mealsPerDay;
+    double   weeklyWorkoutHours;
+    GoalType goal;
+    int      dailyCaloriesLog[NUMBER_OF_DAYS];
+};
+
+// Reads a members file one member at a time, so batch modes that handle
+// each member on its own never hold the whole file in memory.
+struct MemberProfileReader
+{
+    ifstream file;
+    string   fileName;
+    int      lineNumber;
+    bool     invalidLine;   // Stopped at a line that is not a valid member
+    bool     readFailed;    // Stopped because the file could not be read
+    unsigned long long inputHash;   // Hash of every line read so far, each with "\n"
+};
+
+// Running statistics for a member's weekly calorie log
+struct WeeklyCalorieStats
+{
+    long long totalCalories;
+    int       highestCalories;
+    int       entryCount;
+};
+
+// A calorie entry appended to a member's log (day is 0-based)
+struct CalorieEntry
+{
+    int memberIndex;
+    int day;
+    int calories;
+};
+
+// Slot in the calorie entry ring. The sequence number tells producers and
+// consumers whether the slot is free or holds an entry for the current lap.
+struct CalorieEntryCell
+{
+    atomic<size_t> sequence;
+    CalorieEntry   entry;
+};
+
+// Bounded lock-free ring buffer that many producer threads can push into.
+// The two positions live on separate cache lines so producers and the
+// consumer do not fight over the same line. The rings are kept in a vector,
+// which does not honor alignas before C++17, so a full line of padding
+// separates the positions whatever address the ring gets.
+struct CalorieEntryRing
+{
+    unique_ptr<CalorieEntryCell[]> cells;
+    size_t         mask;
+    char           enqueuePadding[CACHE_LINE_BYTES];
+    atomic<size_t> enqueuePosition;
+    char           dequeuePadding[CACHE_LINE_BYTES];
+    atomic<size_t> dequeuePosition;
+    char           trailingPadding[CACHE_LINE_BYTES];
+};
+
+// Everything one report is rendered from
+struct ReportValues
+{
+    string name;
+    string favoriteProtein;
+    int    dailyCalories;
+    int    weeklyCalories;
+    int    dailyProteinGrams;
+    int    dailyCarbGrams;
+    int    dailyFatGrams;
+    int    dailyProteinCalories;
+    int    dailyCarbCalories;
+    int    dailyFatCalories;
+    int    totalProteinGrams;
+    int    totalCarbGrams;
+    int    totalFatGrams;
+    int    mealsPerDay;
+    double weeklyWorkoutHours;
+    int    proteinPerMeal;
+    int    carbsPerMeal;
+    int    fatsPerMeal;
+};
+
+// Buffered output for the streaming export. Values are formatted straight
+// into the buffer, so writing a record does not allocate.
+struct ExportWriter
+{
+    ostream* out;
+    char     buffer[EXPORT_BUFFER_SIZE];
+    int      used;
+};
+
+// Stream buffer that reads from another buffer one character at a time and
+// keeps a copy of every character the program consumes.
+struct RecordingInputBuffer : public streambuf
+{
+    streambuf* source;
+    string*    recorded;
+    char       current;
+
+    int_type underflow() override
+    {
+        int_type next = source->sbumpc();
+
+        if (next == traits_type::eof())
+            return next;
+
+        current = traits_type::to_char_type(next);
+        recorded->push_back(current);
+        setg(&current, &current, &current + 1);
+        return next;
+    }
+};
+
+// Stream buffer that writes to another buffer and keeps a copy of the output.
+struct RecordingOutputBuffer : public streambuf
+{
+    streambuf* destination;
+    string*    recorded;
+
+    int_type overflow(int_type character) override
+    {
+        if (character == traits_type::eof())
+            return traits_type::not_eof(character);
+
+        recorded->push_back(traits_type::to_char_type(character));
+        return destination->sputc(traits_type::to_char_type(character));
+    }
+
+    streamsize xsputn(const char* text, streamsize count) override
+    {
+        recorded->append(text, static_cast<size_t>(count));
+        return destination->sputn(text, count);
+    }
+
+    int sync() override
+    {
+        return destination->pubsync();
+    }
+};
+
+// Input stream buffer for replay. Running out of recorded input means the
+// session no longer behaves as recorded, so it throws instead of letting
+// the input loops spin forever at end of input.
+struct ReplayInputBuffer : public streambuf
+{
+    const string* input;
+    size_t        position;
+
+    int_type underflow() override
+    {
+        if (position >= input->length())
+            throw ios_base::failure("Recorded input ran out");
+
+        char* begin = const_cast<char*>(input->data());
+        setg(begin, begin + position, begin + input->length());
+        position = input->length();
+        return traits_type::to_int_type(*gptr());
+    }
+};
+
+// Everything a recorded session typed and everything it printed
+struct SessionRecording
+{
+    string input;
+    string transcript;
+};
+
+// Projected change in body weight (pounds) at the end of one week.
+// Low and high bound the middle 80 percent of the simulated outcomes.
+struct WeightProjectionBand
+{
+    float low;
+    float median;
+    float high;
+};
+
+// Totals for a group of members. Each finished shard saves its totals, and
+// they are added together when the shards are merged.
+struct CohortStats
+{
+    long long memberCount;
+    long long goalCounts[MUSCLE_GAIN + 1];
+    long long dailyCalories;
+    long long dailyProteinGrams;
+    long long dailyCarbGrams;
+    long long dailyFatGrams;
+    long long nutritionOutcomes[NUTRITION_OUTCOME_COUNT];
+};
+
+// Text stored in a snapshot's string pool (not null terminated)
+struct SnapshotString
+{
+    uint64_t offset;       // From the start of the string pool
+    uint32_t length;
+    uint32_t reserved;
+};
+
+// Start of a snapshot file. Every other part of the file is found through
+// the byte offsets here, so the file can be mapped at any address and used
+// without any pointer fixups.
+struct SnapshotHeader
+{
+    char           magic[8];
+    uint64_t       fileBytes;
+    uint64_t       memberCount;
+    uint64_t       membersOffset;     // SnapshotMember records
+    uint64_t       lookupOffset;      // Name hash slots holding member index + 1
+    uint64_t       lookupSlots;       // Always a power of two
+    uint64_t       stringsOffset;
+    uint64_t       stringBytes;
+    uint64_t       reportsOffset;     // Copy of the packed report file
+    uint64_t       reportBytes;
+};
+
+// One member's inputs and everything computed from them, as stored in a
+// snapshot. Only fixed-width fields, so the layout is the same everywhere.
+struct SnapshotMember
+{
+    SnapshotString name;
+    SnapshotString favoriteProtein;
+    double         weeklyWorkoutHours;
+    int32_t        dailyCalories;
+    int32_t        mealsPerDay;
+    int32_t        goal;
+    int32_t        dailyCaloriesLog[NUMBER_OF_DAYS];
+
+    // Macro plan
+    int32_t        weeklyCalories;
+    int32_t        dailyProteinGrams;
+    int32_t        dailyCarbGrams;
+    int32_t        dailyFatGrams;
+    int32_t        totalProteinGrams;
+    int32_t        totalCarbGrams;
+    int32_t        totalFatGrams;
+    int32_t        proteinPerMeal;
+    int32_t        carbsPerMeal;
+    int32_t        fatsPerMeal;
+
+    // Weekly calorie stats
+    int64_t        totalCalories;
+    int32_t        highestCalories;
+    int32_t        entryCount;
+
+    // Where the member's report is in the snapshot's copy of the report
+    int64_t        reportOffset;
+    int64_t        reportLength;
+    uint64_t       reportHash;        // Hash of the report text, to spot a damaged file
+};
+
+static_assert(sizeof(SnapshotHeader) == 80, "Snapshot header layout changed");
+static_assert(sizeof(SnapshotMember) == 160, "Snapshot member layout changed");
+
+// A snapshot file opened for reading. The header is copied out when the file
+// is opened, and one window of the rest is mapped at a time.
+struct MappedSnapshot
+{
+    HANDLE         file;
+    HANDLE         mapping;
+    uint64_t       fileBytes;
+    SnapshotHeader header;
+    const char*    view;
+    uint64_t       viewOffset;
+    uint64_t       viewBytes;
+};
+
+// Where a report section was written, two unrelated hashes of the inputs it
+// was rendered from, and a hash of the text itself. Saved next to the report
+// so the next run can tell which sections changed and that the text on disk
+// is still what was written.
+struct ReportSectionIndex
+{
+    long long          offset;
+    long long          length;
+    unsigned long long inputHash;
+    unsigned long long inputCheck;
+    unsigned long long textHash;
+};
+
+// Rendered screen or report text. The fingerprint is the exact set of inputs
+// the text was rendered from, so a hash collision can never serve wrong text.
+struct RenderCacheEntry
+{
+    unsigned long long key;
+    string fingerprint;
+    string rendered;
+};
+
+// Least recently used cache of rendered output with a memory cap.
+// The list keeps entries in use order (most recent first) and the map finds
+// an entry by the hash of its fingerprint.
+struct RenderCache
+{
+    list<RenderCacheEntry> entries;
+    unordered_map<unsigned long long, list<RenderCacheEntry>::iterator> index;
+    size_t bytesUsed;
+    size_t byteLimit;
+    long long hits;
+    long long misses;
+};
+
+// Number of self-test checks that passed and failed
+struct SelfTestResults
+{
+    int passed;
+    int failed;
+};
+
 
 // ======================== FUNCTION PROTOTYPES =============================
 
 // Utility
 void setConsoleColor(int color);
-void printSectionBreakLine();
+void printSectionBreakLine(ostream& out = cout);
 void clearInputStream();
+void printErrorMessage(string message, ostream& out = cerr);
+ostream& printSummaryLabel(string label);
+void printElapsedSummary(double elapsedSeconds, double itemCount, string itemName);
 
 // Enum input
 GoalType getUserGoal();
@@ -99,35 +573,147 @@ int findHighestCalories(const int dailyCaloriesLog[], int size);
 void displayIntroBanner();
 void displayMenu();
 
-void displayDailyMacros(string name, string favoriteProtein,
+void displayDailyMacros(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int mealsPerDay, double weeklyWorkoutHours,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int proteinPerMeal, int carbsPerMeal, int fatsPerMeal);
 
-void processReportGeneration(string name, string favoriteProtein,
+void processReportGeneration(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int weeklyCalories,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int totalProteinGrams, int totalCarbGrams, int totalFatGrams,
     int mealsPerDay, double weeklyWorkoutHours,
     int proteinPerMeal, int carbsPerMeal, int fatsPerMeal);
 
-void displayNutritionCheckAndRecipe(int dailyCalories,
-    int mealsPerDay, double weeklyWorkoutHours, GoalType goal);
+void displayNutritionCheckAndRecipe(RenderCache& renderCache,
+    int dailyCalories, int mealsPerDay, double weeklyWorkoutHours,
+    GoalType goal);
 
 // Supporting Functions for Menu Options
-void generateReport(string name, string favoriteProtein,
+void generateReport(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int weeklyCalories,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int totalProteinGrams, int totalCarbGrams, int totalFatGrams,
     int mealsPerDay, double weeklyWorkoutHours,
     int proteinPerMeal, int carbsPerMeal, int fatsPerMeal);
 
-void evaluateNutrition(int dailyCalories, double weeklyWorkoutHours,
-    GoalType goal);
-void evaluateMealFrequency(int mealsPerWeek, double weeklyWorkoutHours);
-void displaySmoothieRecipe();
+void evaluateNutrition(ostream& out, int dailyCalories,
+    double weeklyWorkoutHours, GoalType goal);
+void evaluateMealFrequency(ostream& out, int mealsPerWeek,
+    double weeklyWorkoutHours);
+void displaySmoothieRecipe(ostream& out);
+NutritionOutcome classifyNutrition(const MacroPolicy& policy,
+    int dailyCalories, double weeklyWorkoutHours);
+MealFrequencyOutcome classifyMealFrequency(const MacroPolicy& policy,
+    int mealsPerWeek, double weeklyWorkoutHours);
+
+// Report Sections
+void   buildReportValues(const MemberProfile& member, ReportValues& values);
+void   calculateMacroCalories(ReportValues& values);
+string buildReportSectionFingerprint(const ReportValues& values, int section);
+string renderReportSection(const ReportValues& values, int section);
+string convertReportLineEndings(const string& text);
+bool   loadReportIndex(string indexFileName, vector<ReportSectionIndex>& index);
+bool   saveReportIndex(string indexFileName,
+    const vector<ReportSectionIndex>& index);
+bool   writeReportSections(RenderCache& renderCache, string fileName,
+    const vector<ReportValues>& reports, long long& sectionsRewritten);
+int    runReportsMode(string membersFile, string reportFile);
+
+// Streaming Export
+void flushExportWriter(ExportWriter& writer);
+void writeExportBytes(ExportWriter& writer, const char* bytes, int count);
+void writeExportInt(ExportWriter& writer, long long value);
+long long roundToHundredths(double value);
+void writeExportHundredths(ExportWriter& writer, double value);
+void writeExportCsvText(ExportWriter& writer, const string& text);
+void writeExportJsonText(ExportWriter& writer, const string& text);
+void writeExportBinaryText(ExportWriter& writer, const string& text);
+void writeExportBinaryInt(ExportWriter& writer, int value);
+void writeExportHeader(ExportWriter& writer, ExportFormat format);
+void writeExportRecord(ExportWriter& writer, ExportFormat format,
+    const ReportValues& values);
+int  runExportMode(string formatName, string membersFile, string outputFile);
+
+// Session Record and Replay
+bool saveSessionRecording(string fileName, const SessionRecording& recording);
+bool loadSessionRecording(string fileName, SessionRecording& recording);
+int  findFirstDifferentLine(const string& expected, const string& actual);
+string normalizeReportFileName(string transcript, const string& reportFileName);
+int  runRecordMode(string recordingFile);
+int  runReplayMode(int fileCount, char* fileNames[]);
+
+// Memory-Mapped Snapshot
+SnapshotString addSnapshotString(string& strings, const string& text);
+const char* mapSnapshotRange(MappedSnapshot& snapshot, uint64_t offset,
+    uint64_t length);
+string getSnapshotString(MappedSnapshot& snapshot, const SnapshotString& text);
+bool writeSnapshot(string fileName, const vector<MemberProfile>& members,
+    const vector<ReportValues>& reports,
+    const vector<ReportSectionIndex>& reportIndex, string reportFileName);
+bool openSnapshot(string fileName, MappedSnapshot& snapshot);
+void closeSnapshot(MappedSnapshot& snapshot);
+bool findSnapshotMember(MappedSnapshot& snapshot, const string& name,
+    SnapshotMember& member);
+int  runSnapshotWriteMode(string membersFile, string reportFile,
+    string snapshotFile);
+int  runSnapshotQueryMode(string snapshotFile, int nameCount, char* names[]);
+
+// Sharded Batch Runs
+string getShardFileName(string outputFile, int shard, string extension);
+void getCohortStatsFields(CohortStats& stats, vector<long long*>& fields);
+void addCohortStats(CohortStats& total, CohortStats part);
+bool saveShardCheckpoint(string fileName, unsigned long long inputHash,
+    int shardCount, CohortStats stats);
+bool loadShardCheckpoint(string fileName, unsigned long long& inputHash,
+    int& shardCount, CohortStats& stats);
+bool isShardCheckpointCurrent(string outputFile, int shard,
+    unsigned long long inputHash, int shardCount, CohortStats& stats);
+string readCsvFirstField(const string& line);
+bool readCsvRecord(istream& in, string& record);
+bool partitionMembers(string membersFile, string outputFile, int shardCount,
+    vector<unsigned long long>& inputHashes);
+bool launchShardWorker(string programPath, string inputFile,
+    string outputFile, int shardCount, HANDLE& process);
+bool mergeShardOutputs(string outputFile, int shardCount);
+int  runShardWorkerMode(string inputFile, string outputFile, int shardCount);
+int  runShardMode(string membersFile, string outputFile, int shardCount);
+
+// Self-Test
+void checkSelfTest(SelfTestResults& results, bool passed, string description);
+void testCalorieIngestion(SelfTestResults& results);
+void testRenderedOutputCache(SelfTestResults& results);
+string readSelfTestFile(string fileName);
+void testIncrementalReport(SelfTestResults& results);
+void testStreamingExport(SelfTestResults& results);
+void testSessionReplay(SelfTestResults& results);
+void testWeightProjection(SelfTestResults& results);
+void testPolicySweep(SelfTestResults& results);
+void testSnapshotLookup(SelfTestResults& results);
+void testMacroMath(SelfTestResults& results);
+void testShardRuns(SelfTestResults& results);
+int  runSelfTestMode();
+
+// Rendered Output Cache
+void appendFingerprintInt(string& fingerprint, int value);
+void appendFingerprintDouble(string& fingerprint, double value);
+void appendFingerprintText(string& fingerprint, const string& text);
+void setRenderColor(ostream& out, int color);
+void printRenderedOutput(const string& rendered);
+unsigned long long hashFingerprint(const string& fingerprint);
+unsigned long long checkFingerprint(const string& fingerprint);
+unsigned long long extendFingerprintHash(unsigned long long hash,
+    const string& text);
+void initRenderCache(RenderCache& cache, size_t byteLimit);
+const string* findRenderedOutput(RenderCache& cache, const string& fingerprint);
+void storeRenderedOutput(RenderCache& cache, const string& fingerprint,
+    const string& rendered);
 
 // Input Validation
+bool   hasControlCharacters(const string& text);
 string getValidatedStringInput(string requestInput);
 int    getValidatedIntInput(string requestInput);
 double getValidatedDoubleInput(string requestInput);
@@ -138,17 +724,111 @@ void calculateMacros(int dailyCalories, int mealsPerDay,
     int& proteinPerMeal, int& carbsPerMeal, int& fatsPerMeal,
     int& weeklyCalories,
     int& totalProteinGrams, int& totalCarbGrams, int& totalFatGrams);
+void calculateMacros(const MacroPolicy& policy,
+    int dailyCalories, int mealsPerDay,
+    int& dailyProteinGrams, int& dailyCarbGrams, int& dailyFatGrams,
+    int& proteinPerMeal, int& carbsPerMeal, int& fatsPerMeal,
+    int& weeklyCalories,
+    int& totalProteinGrams, int& totalCarbGrams, int& totalFatGrams);
+int  calculateMacroGrams(int dailyCalories, int basisPoints,
+    int caloriesPerGram);
+
+// Policy Sweep
+bool parseMacroPolicyLine(const string& line, MacroPolicy& policy);
+bool loadSweepGrid(string fileName, vector<MacroPolicy>& grid);
+void sweepMemberBlock(const vector<MacroPolicy>& grid,
+    const SweepMember members[], int memberCount, vector<SweepTotals>& totals);
+int  runSweepMode(string membersFile, string gridFile, string outputFile);
+
+// Interactive Session
+void runInteractiveSession();
+
+// Weight Projection
+void displayWeightProjection(int dailyCalories, double weeklyWorkoutHours,
+    GoalType goal, const int dailyCaloriesLog[]);
+int  estimateMaintenanceCalories(int dailyCalories, GoalType goal);
+unsigned int mixCounter(unsigned int value);
+float counterNormal(unsigned long long key, unsigned int counter);
+void simulateWeightChange(unsigned long long key, int firstSimulation,
+    int lastSimulation, int simulations, int weeks, int bandInterval,
+    float intakeMean, float intakeSpread, float maintenanceCalories,
+    float weeklyWorkoutHours, float weightChanges[]);
+void projectWeightTrajectory(int dailyCalories, double weeklyWorkoutHours,
+    GoalType goal, const int dailyCaloriesLog[], int weeks, int bandInterval,
+    int simulations, int threadCount, unsigned long long seed,
+    vector<WeightProjectionBand>& bands);
+int  runProjectMode(string membersFile, string outputFile, int weeks,
+    int simulations);
+
+// Batch Mode
+int  runBatchMode(int argc, char* argv[]);
+bool parseMemberProfileLine(const string& line, MemberProfile& member);
+bool openMemberProfiles(string fileName, MemberProfileReader& reader);
+bool readMemberProfile(MemberProfileReader& reader, MemberProfile& member);
+bool loadMemberProfiles(string fileName, vector<MemberProfile>& members);
+bool loadCalorieEntries(string fileName, int memberCount,
+    vector<CalorieEntry>& entries);
+
+// Calorie Entry Ingestion
+void initCalorieEntryRing(CalorieEntryRing& ring, size_t capacity);
+bool tryPushCalorieEntry(CalorieEntryRing& ring, const CalorieEntry& entry);
+bool tryPopCalorieEntry(CalorieEntryRing& ring, CalorieEntry& entry);
+void pushCalorieEntry(CalorieEntryRing& ring, const CalorieEntry& entry);
+void initWeeklyCalorieStats(const MemberProfile& member,
+    WeeklyCalorieStats& stats);
+void applyCalorieEntry(MemberProfile& member, WeeklyCalorieStats& stats,
+    const CalorieEntry& entry);
+void ingestCalorieEntries(vector<MemberProfile>& members,
+    vector<WeeklyCalorieStats>& stats, const vector<CalorieEntry>& entries,
+    int producerCount, int consumerCount);
+int  runIngestMode(string membersFile, string entriesFile,
+    int producerCount, int consumerCount);
 
 
 // ============================= MAIN FUNCTION ==============================
 // Main function controlling program flow and user interaction
-int main()
+int main(int argc, char* argv[])
+{
+    // Command line arguments select one of the batch modes instead of the
+    // interactive session
+    if (argc > 1)
+        return runBatchMode(argc, argv);
+
+    runInteractiveSession();
+
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that returns the whole grams of a macro that make up basisPoints
+//     of dailyCalories (rounded down).
+// Integer math only, so every build and thread gets exactly the same grams.
+// ---------------------------------------------------------------------------
+int calculateMacroGrams(int dailyCalories, int basisPoints, int caloriesPerGram)
+{
+    long long macroCalorieShare = static_cast<long long>(dailyCalories) * basisPoints;
+
+    return static_cast<int>(macroCalorieShare /
+        (static_cast<long long>(BASIS_POINTS_PER_WHOLE) * caloriesPerGram));
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that runs the interactive program: greets the user, collects
+//     their inputs, and shows the menu until they exit.
+// ---------------------------------------------------------------------------
+void runInteractiveSession()
 {
     // Setting variables outside loop to use throughout program  
     string name;
     int menuChoice = 0;
     char startNewSession = 'n';
 
+    // Rendered screens and reports are reused across sessions
+    RenderCache renderCache;
+    initRenderCache(renderCache, RENDER_CACHE_BYTE_LIMIT);
+
     // Use fixed point formatting with two decimal places for doubles
     cout << fixed << showpoint << setprecision(2);
 
@@ -222,7 +902,7 @@ int main()
             {
                 clearInputStream();
                 setConsoleColor(COLOR_ERROR);
-                cout << "Invalid choice. Please enter a number from 1 to 5.\n\n";
+                cout << "Invalid choice. Please enter a number from 1 to 7.\n\n";
                 setConsoleColor(COLOR_DEFAULT);
                 continue;   // Re-display the menu
             }
@@ -232,7 +912,7 @@ int main()
             {
             case 1:
                 // Show suggested daily macros and per meal breakdown
-                displayDailyMacros(name, favoriteProtein,
+                displayDailyMacros(renderCache, name, favoriteProtein,
                     dailyCalories, mealsPerDay, weeklyWorkoutHours,
                     dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
                     proteinPerMeal, carbsPerMeal, fatsPerMeal);
@@ -240,7 +920,7 @@ int main()
 
             case 2:
                 // Write a formatted report to report.txt
-                processReportGeneration(name, favoriteProtein,
+                processReportGeneration(renderCache, name, favoriteProtein,
                     dailyCalories, weeklyCalories,
                     dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
                     totalProteinGrams, totalCarbGrams, totalFatGrams,
@@ -250,7 +930,7 @@ int main()
 
             case 3:
                 // Check calorie intake vs activity amd show smoothie recipe
-                displayNutritionCheckAndRecipe(dailyCalories,
+                displayNutritionCheckAndRecipe(renderCache, dailyCalories,
                     mealsPerDay, weeklyWorkoutHours, goal);
                 break;
 
@@ -275,9 +955,15 @@ int main()
                 setConsoleColor(COLOR_DEFAULT);
                 break;
 
+            case 7:
+                // Project body weight over the coming weeks from the log
+                displayWeightProjection(dailyCalories, weeklyWorkoutHours,
+                    goal, dailyCaloriesLog);
+                break;
+
             default:
                 setConsoleColor(COLOR_ERROR);
-                cout << "Invalid choice. Please select 16.\n\n";
+                cout << "Invalid choice. Please select 17.\n\n";
                 setConsoleColor(COLOR_DEFAULT);
                 break;
             }
@@ -287,14 +973,12 @@ int main()
         // Clear leftover newline from menu input
         clearInputStream();
 
-        // Check if user decided to start a new session (4 = new session)
+        // Check if user decided to start a new session (5 = new session)
         startNewSession = (menuChoice == 5) ? 'y' : 'n';
 
     } while (startNewSession == 'y');
 
     cout << "\nProgram ended. Have a great day!\n";
-
-    return 0;
 }
 
 
@@ -305,6 +989,9 @@ int main()
 // ---------------------------------------------------------------------------
 void setConsoleColor(int color)
 {
+    if (!consoleColorsEnabled)
+        return;
+
     // Handle is a Windows data type that references the console
     // GetSTDHandle is a Windows function that retrieves the console/output device
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -317,10 +1004,10 @@ void setConsoleColor(int color)
 // ---------------------------------------------------------------------------
 // Function to print section lines
 // ---------------------------------------------------------------------------
-void printSectionBreakLine()
+void printSectionBreakLine(ostream& out)
 {
-    cout << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
-    cout << setfill(' ');
+    out << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
+    out << setfill(' ');
 }
 
 
@@ -335,6 +1022,45 @@ void clearInputStream()
 }
 
 
+// ---------------------------------------------------------------------------
+// Function that prints an error message in the error color.
+// Batch modes print to standard error, so an error never ends up mixed into
+//     data written to standard output.
+// ---------------------------------------------------------------------------
+void printErrorMessage(string message, ostream& out)
+{
+    setConsoleColor(COLOR_ERROR);
+    out << "Error: " << message << "\n";
+    setConsoleColor(COLOR_DEFAULT);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that starts a line of a batch mode summary: the label padded
+//     with dots to 50 columns. Returns cout so the value can follow it.
+// ---------------------------------------------------------------------------
+ostream& printSummaryLabel(string label)
+{
+    cout << left << setw(50) << setfill('.') << label << right << setfill(' ');
+    return cout;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that prints how long a batch mode took and, when it handled any
+//     items, how many it handled per second.
+// ---------------------------------------------------------------------------
+void printElapsedSummary(double elapsedSeconds, double itemCount, string itemName)
+{
+    cout << fixed << showpoint << setprecision(3);
+    printSummaryLabel("Elapsed seconds: ") << elapsedSeconds << "\n";
+
+    if (elapsedSeconds > 0.0 && itemCount > 0.0)
+        printSummaryLabel(itemName + " per second: ")
+            << static_cast<long long>(itemCount / elapsedSeconds) << "\n";
+}
+
+
 // ---------------------------------------------------------------------------
 // Function to display the introduction banner and greeting.
 // ---------------------------------------------------------------------------
@@ -464,7 +1190,8 @@ void displayMenu()
         << "3. Check Nutrition and Unlock Recipe\n"
         << "4. View Weekly Calorie Log\n"
         << "5. Start a New Session\n"
-        << "6. Exit Program\n\n";
+        << "6. Exit Program\n"
+        << "7. Project Weight Trajectory\n\n";
     setConsoleColor(COLOR_DEFAULT);
 }
 
@@ -472,45 +1199,76 @@ void displayMenu()
 // ---------------------------------------------------------------------------
 // Function to display menu option 1.
 // ---------------------------------------------------------------------------
-void displayDailyMacros(string name, string favoriteProtein,
+void displayDailyMacros(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int mealsPerDay, double weeklyWorkoutHours,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int proteinPerMeal, int carbsPerMeal, int fatsPerMeal)
 {
-    setConsoleColor(COLOR_SUB_HEADING);
-    printSectionBreakLine();
-    cout << "You chose to view your suggested daily macros!\n\n";
-    setConsoleColor(COLOR_DEFAULT);
-
-    cout << "Here is the information you provided:\n";
-    cout << left << setw(50) << setfill('.') << "Favorite protein source: " << right << favoriteProtein << "\n";
-    cout << left << setw(50) << setfill('.') << "Daily calorie target: " << right << dailyCalories << "\n";
-    cout << left << setw(50) << setfill('.') << "Meals per day: " << right << mealsPerDay << "\n";
-    cout << left << setw(50) << setfill('.') << "Weekly workout hours: " << right << weeklyWorkoutHours << "\n\n";
-
-    cout << "Suggested daily macros:\n";
-    cout << left << setw(50) << setfill('.') << "Protein: " << right << dailyProteinGrams << " grams\n";
-    cout << left << setw(50) << setfill('.') << "Carbs: " << right << dailyCarbGrams << " grams\n";
-    cout << left << setw(50) << setfill('.') << "Fats: " << right << dailyFatGrams << " grams\n\n";
-
-    cout << "Per meal macro targets:\n";
-    cout << left << setw(50) << setfill('.') << "Protein grams per meal: " << right << proteinPerMeal << "\n";
-    cout << left << setw(50) << setfill('.') << "Carbs grams per meal: " << right << carbsPerMeal << "\n";
-    cout << left << setw(50) << setfill('.') << "Fats grams per meal: " << right << fatsPerMeal << "\n";
+    // Every input that affects the screen goes into the fingerprint
+    string fingerprint;
+    appendFingerprintText(fingerprint, "macros");
+    appendFingerprintText(fingerprint, name);
+    appendFingerprintText(fingerprint, favoriteProtein);
+    appendFingerprintInt(fingerprint, dailyCalories);
+    appendFingerprintInt(fingerprint, mealsPerDay);
+    appendFingerprintDouble(fingerprint, weeklyWorkoutHours);
+    appendFingerprintInt(fingerprint, dailyProteinGrams);
+    appendFingerprintInt(fingerprint, dailyCarbGrams);
+    appendFingerprintInt(fingerprint, dailyFatGrams);
+    appendFingerprintInt(fingerprint, proteinPerMeal);
+    appendFingerprintInt(fingerprint, carbsPerMeal);
+    appendFingerprintInt(fingerprint, fatsPerMeal);
+
+    const string* cached = findRenderedOutput(renderCache, fingerprint);
+
+    if (cached != nullptr)
+    {
+        printRenderedOutput(*cached);
+        return;
+    }
 
-    setConsoleColor(COLOR_SUB_HEADING);
-    printSectionBreakLine();
-    cout << "Keep fueling with " << favoriteProtein << " to hit " << dailyProteinGrams << " grams of protein daily!\n";
-    cout << "Remember your " << weeklyWorkoutHours << " hours of weightlifting per week...\n";
-    cout << "Keep lifting heavy, " << name << "!\n\n";
-    setConsoleColor(COLOR_DEFAULT);
+    ostringstream out;
+    out << fixed << showpoint << setprecision(2);
+
+    setRenderColor(out, COLOR_SUB_HEADING);
+    printSectionBreakLine(out);
+    out << "You chose to view your suggested daily macros!\n\n";
+    setRenderColor(out, COLOR_DEFAULT);
+
+    out << "Here is the information you provided:\n";
+    out << left << setw(50) << setfill('.') << "Favorite protein source: " << right << favoriteProtein << "\n";
+    out << left << setw(50) << setfill('.') << "Daily calorie target: " << right << dailyCalories << "\n";
+    out << left << setw(50) << setfill('.') << "Meals per day: " << right << mealsPerDay << "\n";
+    out << left << setw(50) << setfill('.') << "Weekly workout hours: " << right << weeklyWorkoutHours << "\n\n";
+
+    out << "Suggested daily macros:\n";
+    out << left << setw(50) << setfill('.') << "Protein: " << right << dailyProteinGrams << " grams\n";
+    out << left << setw(50) << setfill('.') << "Carbs: " << right << dailyCarbGrams << " grams\n";
+    out << left << setw(50) << setfill('.') << "Fats: " << right << dailyFatGrams << " grams\n\n";
+
+    out << "Per meal macro targets:\n";
+    out << left << setw(50) << setfill('.') << "Protein grams per meal: " << right << proteinPerMeal << "\n";
+    out << left << setw(50) << setfill('.') << "Carbs grams per meal: " << right << carbsPerMeal << "\n";
+    out << left << setw(50) << setfill('.') << "Fats grams per meal: " << right << fatsPerMeal << "\n";
+
+    setRenderColor(out, COLOR_SUB_HEADING);
+    printSectionBreakLine(out);
+    out << "Keep fueling with " << favoriteProtein << " to hit " << dailyProteinGrams << " grams of protein daily!\n";
+    out << "Remember your " << weeklyWorkoutHours << " hours of weightlifting per week...\n";
+    out << "Keep lifting heavy, " << name << "!\n\n";
+    setRenderColor(out, COLOR_DEFAULT);
+
+    storeRenderedOutput(renderCache, fingerprint, out.str());
+    printRenderedOutput(out.str());
 }
 
 
 // ---------------------------------------------------------------------------
 // Function to display menu option 2.
 // ---------------------------------------------------------------------------
-void processReportGeneration(string name, string favoriteProtein,
+void processReportGeneration(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int weeklyCalories,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int totalProteinGrams, int totalCarbGrams, int totalFatGrams,
@@ -525,7 +1283,7 @@ void processReportGeneration(string name, string favoriteProtein,
     printSectionBreakLine();
     setConsoleColor(COLOR_DEFAULT);
 
-    generateReport(name, favoriteProtein,
+    generateReport(renderCache, name, favoriteProtein,
         dailyCalories, weeklyCalories,
         dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
         totalProteinGrams, totalCarbGrams, totalFatGrams,
@@ -537,23 +1295,44 @@ void processReportGeneration(string name, string favoriteProtein,
 // ---------------------------------------------------------------------------
 // Function to display menu option 3.
 // ---------------------------------------------------------------------------
-void displayNutritionCheckAndRecipe(int dailyCalories,
-    int mealsPerDay, double weeklyWorkoutHours, GoalType goal)
+void displayNutritionCheckAndRecipe(RenderCache& renderCache,
+    int dailyCalories, int mealsPerDay, double weeklyWorkoutHours,
+    GoalType goal)
 {
-    setConsoleColor(COLOR_SUB_HEADING);
-    printSectionBreakLine();
-    cout << "Checking your calorie intake vs activity level...\n\n";
-    setConsoleColor(COLOR_DEFAULT);
+    string fingerprint;
+    appendFingerprintText(fingerprint, "nutrition");
+    appendFingerprintInt(fingerprint, dailyCalories);
+    appendFingerprintInt(fingerprint, mealsPerDay);
+    appendFingerprintDouble(fingerprint, weeklyWorkoutHours);
+    appendFingerprintInt(fingerprint, static_cast<int>(goal));
+
+    const string* cached = findRenderedOutput(renderCache, fingerprint);
+
+    if (cached != nullptr)
+    {
+        printRenderedOutput(*cached);
+        return;
+    }
+
+    ostringstream out;
+
+    setRenderColor(out, COLOR_SUB_HEADING);
+    printSectionBreakLine(out);
+    out << "Checking your calorie intake vs activity level...\n\n";
+    setRenderColor(out, COLOR_DEFAULT);
 
     // Calories vs. activity and goal guidanec
-    evaluateNutrition(dailyCalories, weeklyWorkoutHours, goal);
+    evaluateNutrition(out, dailyCalories, weeklyWorkoutHours, goal);
 
     // Calculate meals per week before evaluating meal frequency
     int mealsPerWeek = mealsPerDay * NUMBER_OF_DAYS;
-    evaluateMealFrequency(mealsPerWeek, weeklyWorkoutHours);
+    evaluateMealFrequency(out, mealsPerWeek, weeklyWorkoutHours);
 
     // Display recipe
-    displaySmoothieRecipe();
+    displaySmoothieRecipe(out);
+
+    storeRenderedOutput(renderCache, fingerprint, out.str());
+    printRenderedOutput(out.str());
 }
 
 
@@ -596,69 +1375,45 @@ void displayWeeklyCalorieLog(const int dailyCaloriesLog[], int size)
 // Function to write the report for menu option 2 
 //     (used in the processReportGeneration function)
 // ---------------------------------------------------------------------------
-void generateReport(string name, string favoriteProtein,
+void generateReport(RenderCache& renderCache,
+    string name, string favoriteProtein,
     int dailyCalories, int weeklyCalories,
     int dailyProteinGrams, int dailyCarbGrams, int dailyFatGrams,
     int totalProteinGrams, int totalCarbGrams, int totalFatGrams,
     int mealsPerDay, double weeklyWorkoutHours,
     int proteinPerMeal, int carbsPerMeal, int fatsPerMeal)
 {
-    ofstream outFile("report.txt");
-
-    if (!outFile)
+    vector<ReportValues> reports(1);
+    ReportValues& values = reports[0];
+    long long sectionsRewritten = 0;
+
+    values.name = name;
+    values.favoriteProtein = favoriteProtein;
+    values.dailyCalories = dailyCalories;
+    values.weeklyCalories = weeklyCalories;
+    values.dailyProteinGrams = dailyProteinGrams;
+    values.dailyCarbGrams = dailyCarbGrams;
+    values.dailyFatGrams = dailyFatGrams;
+    values.totalProteinGrams = totalProteinGrams;
+    values.totalCarbGrams = totalCarbGrams;
+    values.totalFatGrams = totalFatGrams;
+    values.mealsPerDay = mealsPerDay;
+    values.weeklyWorkoutHours = weeklyWorkoutHours;
+    values.proteinPerMeal = proteinPerMeal;
+    values.carbsPerMeal = carbsPerMeal;
+    values.fatsPerMeal = fatsPerMeal;
+    calculateMacroCalories(values);
+
+    // Only the sections whose inputs changed since the last report are rewritten
+    if (!writeReportSections(renderCache, activeReportFileName, reports, sectionsRewritten))
     {
-        setConsoleColor(COLOR_ERROR);
-        cout << "Error: Unable to open report.txt\n";
-        setConsoleColor(COLOR_DEFAULT);
+        printErrorMessage("Unable to open " + activeReportFileName, cout);
         return;
     }
 
-    // Calculate macro calories per day for the report
-    int dailyProteinCalories = dailyProteinGrams * CALORIES_PER_GRAM_PROTEIN;
-    int dailyCarbCalories = dailyCarbGrams * CALORIES_PER_GRAM_CARBS;
-    int dailyFatCalories = dailyFatGrams * CALORIES_PER_GRAM_FAT;
-
-    // Report header
-    outFile << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
-    outFile << "Vegetarian Nutrition for Weightlifters Report\n";
-    outFile << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n\n";
-
-    outFile << "Information you provided:\n";
-    outFile << left << setw(50) << setfill('.') << "Favorite protein source: " << right << favoriteProtein << "\n";
-    outFile << left << setw(50) << setfill('.') << "Daily calorie target: " << right << dailyCalories << "\n";
-    outFile << left << setw(50) << setfill('.') << "Weekly calorie target: " << right << weeklyCalories << "\n";
-    outFile << left << setw(50) << setfill('.') << "Meals per day: " << right << mealsPerDay << "\n";
-    outFile << fixed << showpoint << setprecision(2);
-    outFile << left << setw(50) << setfill('.') << "Weekly workout hours: " << right << weeklyWorkoutHours << "\n\n";
-
-    // Weekly totals
-    outFile << "Suggested weekly macros:\n";
-    outFile << left << setw(50) << setfill('.') << "Protein: " << right << totalProteinGrams << " grams\n";
-    outFile << left << setw(50) << setfill('.') << "Carbs: " << right << totalCarbGrams << " grams\n";
-    outFile << left << setw(50) << setfill('.') << "Fats: " << right << totalFatGrams << " grams\n\n";
-
-    // Daily macros
-    outFile << "Suggested total daily macros:\n";
-    outFile << left << setw(50) << setfill('.') << "Protein: " << right << dailyProteinGrams << " grams (" << dailyProteinCalories << " cal)\n";
-    outFile << left << setw(50) << setfill('.') << "Carbs: " << right << dailyCarbGrams << " grams (" << dailyCarbCalories << " cal)\n";
-    outFile << left << setw(50) << setfill('.') << "Fats: " << right << dailyFatGrams << " grams (" << dailyFatCalories << " cal)\n\n";
-
-    // Per-meal macros
-    outFile << "Per meal macro targets:\n";
-    outFile << left << setw(50) << setfill('.') << "Protein grams per meal: " << right << proteinPerMeal << "\n";
-    outFile << left << setw(50) << setfill('.') << "Carbs grams per meal: " << right << carbsPerMeal << "\n";
-    outFile << left << setw(50) << setfill('.') << "Fats grams per meal:  " << right << fatsPerMeal << "\n\n";
-
-    outFile << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
-    outFile << "Keep fueling with " << favoriteProtein << " to hit " << dailyProteinGrams << " grams of protein daily!\n";
-    outFile << "Remember your " << weeklyWorkoutHours << " hours of weightlifting per week...\n";
-    outFile << "Keep lifting heavy, " << name << "!\n\n";
-
-    outFile.close();
-
     // Confirm report generation in console using green success message
     setConsoleColor(COLOR_SUB_HEADING);
-    cout << "Report successfully generated: report.txt\n\n";
+    cout << "Report successfully generated: " << activeReportFileName << "\n\n";
     setConsoleColor(COLOR_DEFAULT);
 }
 
@@ -667,33 +1422,41 @@ void generateReport(string name, string favoriteProtein,
 // Function that uses calorie and activity thresholds to give feedback to
 //     the user for menu option 3
 // ---------------------------------------------------------------------------
-void evaluateNutrition(int dailyCalories, double weeklyWorkoutHours, GoalType goal)
+void evaluateNutrition(ostream& out, int dailyCalories, double weeklyWorkoutHours, GoalType goal)
 {
-    if (weeklyWorkoutHours >= ACTIVITY_HIGH && dailyCalories >= CAL_HIGH)
-        cout << "Your intake is sufficient for a high activity week. Keep it up!\n\n";
-    else if (weeklyWorkoutHours >= ACTIVITY_MEDIUM && dailyCalories >= CAL_MEDIUM)
-        cout << "Your intake is decent for your activity level, but you could increase protein slightly.\n\n";
-    else if (weeklyWorkoutHours < ACTIVITY_MEDIUM && dailyCalories < CAL_LOW)
-        cout << "You might be under fueling. Consider adding extra calories per day.\n\n";
-    else if (weeklyWorkoutHours < ACTIVITY_MEDIUM && dailyCalories > CAL_EXCESS)
-        cout << "You may be eating more than your activity requires. Consider slightly reducing calories per day.\n\n";
-    else
-        cout << "Your calorie intake seems balanced for your activity level.\n\n";
+    switch (classifyNutrition(DEFAULT_MACRO_POLICY, dailyCalories, weeklyWorkoutHours))
+    {
+    case NUTRITION_SUFFICIENT:
+        out << "Your intake is sufficient for a high activity week. Keep it up!\n\n";
+        break;
+    case NUTRITION_DECENT:
+        out << "Your intake is decent for your activity level, but you could increase protein slightly.\n\n";
+        break;
+    case NUTRITION_UNDER_FUELING:
+        out << "You might be under fueling. Consider adding extra calories per day.\n\n";
+        break;
+    case NUTRITION_EXCESS:
+        out << "You may be eating more than your activity requires. Consider slightly reducing calories per day.\n\n";
+        break;
+    default:
+        out << "Your calorie intake seems balanced for your activity level.\n\n";
+        break;
+    }
 
     // Additional guidance based on goal(enum used in switch)
     switch (goal)
     {
     case FAT_LOSS:
-        cout << "Goal: Fat loss\n";
-        cout << "Aim for a small, sustainable calorie deficit and prioritize protein.\n\n";
+        out << "Goal: Fat loss\n";
+        out << "Aim for a small, sustainable calorie deficit and prioritize protein.\n\n";
         break;
     case MAINTENANCE:
-        cout << "Goal: Maintenance\n"; 
-        cout << "Keep your calorie intake steady and focus on consistency.\n\n";
+        out << "Goal: Maintenance\n"; 
+        out << "Keep your calorie intake steady and focus on consistency.\n\n";
         break;
     case MUSCLE_GAIN:
-        cout << "Goal: Muscle gain\n"; 
-        cout << "Make sure you're in a slight calorie surplus and hitting your protein target.\n\n";
+        out << "Goal: Muscle gain\n"; 
+        out << "Make sure you're in a slight calorie surplus and hitting your protein target.\n\n";
         break;
     default:
         break;
@@ -705,37 +1468,74 @@ void evaluateNutrition(int dailyCalories, double weeklyWorkoutHours, GoalType go
 // Function that uses weekly meal count and activity level to give feedback to
 //     the user for menu option 3
 // ---------------------------------------------------------------------------
-void evaluateMealFrequency(int mealsPerWeek, double weeklyWorkoutHours)
+void evaluateMealFrequency(ostream& out, int mealsPerWeek, double weeklyWorkoutHours)
 {
-    if (mealsPerWeek >= MEALS_PER_WEEK_MEDIUM &&
-        mealsPerWeek <= MEALS_PER_WEEK_HIGH &&
-        weeklyWorkoutHours >= ACTIVITY_HIGH)
+    switch (classifyMealFrequency(DEFAULT_MACRO_POLICY, mealsPerWeek, weeklyWorkoutHours))
     {
-        cout << "Excellent meal frequency for muscle recovery! Try the smoothie below!\n\n";
+    case MEAL_FREQUENCY_EXCELLENT:
+        out << "Excellent meal frequency for muscle recovery! Try the smoothie below!\n\n";
+        break;
+    case MEAL_FREQUENCY_TOO_LOW:
+        out << "Consider eating more often to support your training. Try the smoothie below!\n\n";
+        break;
+    case MEAL_FREQUENCY_TOO_HIGH:
+        out << "You might be eating more than necessary  ensure portion sizes are balanced. Try the smoothie below!\n\n";
+        break;
+    default:
+        out << "Your meal frequency seems appropriate for your activity level. Try the smoothie below!\n\n";
+        break;
     }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that picks the menu option 3 calorie feedback for a member using
+//     the thresholds in policy.
+// ---------------------------------------------------------------------------
+NutritionOutcome classifyNutrition(const MacroPolicy& policy,
+    int dailyCalories, double weeklyWorkoutHours)
+{
+    if (weeklyWorkoutHours >= policy.activityHigh && dailyCalories >= policy.calHigh)
+        return NUTRITION_SUFFICIENT;
+    else if (weeklyWorkoutHours >= policy.activityMedium && dailyCalories >= policy.calMedium)
+        return NUTRITION_DECENT;
+    else if (weeklyWorkoutHours < policy.activityMedium && dailyCalories < policy.calLow)
+        return NUTRITION_UNDER_FUELING;
+    else if (weeklyWorkoutHours < policy.activityMedium && dailyCalories > policy.calExcess)
+        return NUTRITION_EXCESS;
+    else
+        return NUTRITION_BALANCED;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that picks the menu option 3 meal frequency feedback for a member
+//     using the activity thresholds in policy.
+// ---------------------------------------------------------------------------
+MealFrequencyOutcome classifyMealFrequency(const MacroPolicy& policy,
+    int mealsPerWeek, double weeklyWorkoutHours)
+{
+    if (mealsPerWeek >= MEALS_PER_WEEK_MEDIUM &&
+        mealsPerWeek <= MEALS_PER_WEEK_HIGH &&
+        weeklyWorkoutHours >= policy.activityHigh)
+        return MEAL_FREQUENCY_EXCELLENT;
     else if (mealsPerWeek < MEALS_PER_WEEK_MEDIUM &&
-        weeklyWorkoutHours >= ACTIVITY_MEDIUM)
-    {
-        cout << "Consider eating more often to support your training. Try the smoothie below!\n\n";
-    }
+        weeklyWorkoutHours >= policy.activityMedium)
+        return MEAL_FREQUENCY_TOO_LOW;
     else if (mealsPerWeek > MEALS_PER_WEEK_HIGH)
-    {
-        cout << "You might be eating more than necessary  ensure portion sizes are balanced. Try the smoothie below!\n\n";
-    }
+        return MEAL_FREQUENCY_TOO_HIGH;
     else
-    {
-        cout << "Your meal frequency seems appropriate for your activity level. Try the smoothie below!\n\n";
-    }
+        return MEAL_FREQUENCY_APPROPRIATE;
 }
 
 
 // ---------------------------------------------------------------------------
 // Function to print a recipe for menu option 3
 // ---------------------------------------------------------------------------
-void displaySmoothieRecipe()
+void displaySmoothieRecipe(ostream& out)
 {
-    setConsoleColor(COLOR_RECIPE);
-    cout << "Oatmeal Smoothie Recipe:\n"
+    setRenderColor(out, COLOR_RECIPE);
+    out << "Oatmeal Smoothie Recipe:\n"
         << "- 1/4 cup rolled oats\n"
         << "- 2 tbsp cocoa powder\n"
         << "- 1/4 cup protein powder\n"
@@ -745,10 +1545,27 @@ void displaySmoothieRecipe()
         << "- 3/4 cup almond milk\n\n"
         << "Blend all ingredients until smooth.\n"
         << "Protein: 30g | Carbs: 37g | Fat: 13g\n\n";
-    setConsoleColor(COLOR_SUB_HEADING);
-    printSectionBreakLine();
-    setConsoleColor(COLOR_DEFAULT);
-    cout << endl;
+    setRenderColor(out, COLOR_SUB_HEADING);
+    printSectionBreakLine(out);
+    setRenderColor(out, COLOR_DEFAULT);
+    out << endl;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks text for control characters (tabs, line breaks, and
+//     the color marker used in rendered screens). Names and proteins are
+//     printed inside rendered text, so they must not contain any.
+// ---------------------------------------------------------------------------
+bool hasControlCharacters(const string& text)
+{
+    for (size_t index = 0; index < text.length(); ++index)
+    {
+        if (static_cast<unsigned char>(text[index]) < 0x20 || text[index] == 0x7F)
+            return true;
+    }
+
+    return false;
 }
 
 
@@ -764,8 +1581,8 @@ string getValidatedStringInput(string requestInput)
     getline(cin, value);
     cout << endl;
 
-    // Repeat until the user enters a non-empty string
-    while (value.length() == 0)
+    // Repeat until the user enters a non-empty string without control characters
+    while (value.length() == 0 || hasControlCharacters(value))
     {
         setConsoleColor(COLOR_ERROR);
         cout << "That is not a valid answer. Please try again: ";
@@ -848,14 +1665,33 @@ void calculateMacros(int  dailyCalories, int  mealsPerDay,
     int& proteinPerMeal, int& carbsPerMeal, int& fatsPerMeal,
     int& weeklyCalories,
     int& totalProteinGrams, int& totalCarbGrams, int& totalFatGrams)
+{
+    calculateMacros(DEFAULT_MACRO_POLICY, dailyCalories, mealsPerDay,
+        dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
+        proteinPerMeal, carbsPerMeal, fatsPerMeal,
+        weeklyCalories,
+        totalProteinGrams, totalCarbGrams, totalFatGrams);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that does the calculateMacros work with the ratios taken from
+//     policy instead of the constants (used by the sweep mode).
+// ---------------------------------------------------------------------------
+void calculateMacros(const MacroPolicy& policy,
+    int dailyCalories, int mealsPerDay,
+    int& dailyProteinGrams, int& dailyCarbGrams, int& dailyFatGrams,
+    int& proteinPerMeal, int& carbsPerMeal, int& fatsPerMeal,
+    int& weeklyCalories,
+    int& totalProteinGrams, int& totalCarbGrams, int& totalFatGrams)
 {
     // Daily macro grams based on percentage of calories
-    dailyProteinGrams = static_cast<int>((dailyCalories * PROTEIN_PERCENT) /
-        CALORIES_PER_GRAM_PROTEIN);
-    dailyCarbGrams = static_cast<int>((dailyCalories * CARB_PERCENT) /
-        CALORIES_PER_GRAM_CARBS);
-    dailyFatGrams = static_cast<int>((dailyCalories * FAT_PERCENT) /
-        CALORIES_PER_GRAM_FAT);
+    dailyProteinGrams = calculateMacroGrams(dailyCalories,
+        policy.proteinBasisPoints, CALORIES_PER_GRAM_PROTEIN);
+    dailyCarbGrams = calculateMacroGrams(dailyCalories,
+        policy.carbBasisPoints, CALORIES_PER_GRAM_CARBS);
+    dailyFatGrams = calculateMacroGrams(dailyCalories,
+        policy.fatBasisPoints, CALORIES_PER_GRAM_FAT);
 
     // Per meal targets.
     proteinPerMeal = dailyProteinGrams / mealsPerDay;
@@ -877,3 +1713,4404 @@ void calculateMacros(int  dailyCalories, int  mealsPerDay,
         totalFatGrams += dailyFatGrams;
     }
 }
+
+
+// ======================== REPORT SECTION DEFINITIONS =======================
+
+// ---------------------------------------------------------------------------
+// Function that fills the report values for a member from the batch input.
+// ---------------------------------------------------------------------------
+void buildReportValues(const MemberProfile& member, ReportValues& values)
+{
+    values.name = member.name;
+    values.favoriteProtein = member.favoriteProtein;
+    values.dailyCalories = member.dailyCalories;
+    values.mealsPerDay = member.mealsPerDay;
+    values.weeklyWorkoutHours = member.weeklyWorkoutHours;
+
+    calculateMacros(member.dailyCalories, member.mealsPerDay,
+        values.dailyProteinGrams, values.dailyCarbGrams, values.dailyFatGrams,
+        values.proteinPerMeal, values.carbsPerMeal, values.fatsPerMeal,
+        values.weeklyCalories,
+        values.totalProteinGrams, values.totalCarbGrams, values.totalFatGrams);
+
+    calculateMacroCalories(values);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that calculates the calories supplied by each daily macro.
+// The text report and the export both read these values so they always agree.
+// ---------------------------------------------------------------------------
+void calculateMacroCalories(ReportValues& values)
+{
+    values.dailyProteinCalories = values.dailyProteinGrams * CALORIES_PER_GRAM_PROTEIN;
+    values.dailyCarbCalories = values.dailyCarbGrams * CALORIES_PER_GRAM_CARBS;
+    values.dailyFatCalories = values.dailyFatGrams * CALORIES_PER_GRAM_FAT;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that lists the inputs a report section depends on.
+// Two sections with the same fingerprint always render the same text.
+// ---------------------------------------------------------------------------
+string buildReportSectionFingerprint(const ReportValues& values, int section)
+{
+    string fingerprint;
+    appendFingerprintText(fingerprint, "report");
+    appendFingerprintInt(fingerprint, section);
+
+    switch (section)
+    {
+    case REPORT_INPUTS:
+        appendFingerprintText(fingerprint, values.favoriteProtein);
+        appendFingerprintInt(fingerprint, values.dailyCalories);
+        appendFingerprintInt(fingerprint, values.weeklyCalories);
+        appendFingerprintInt(fingerprint, values.mealsPerDay);
+        appendFingerprintDouble(fingerprint, values.weeklyWorkoutHours);
+        break;
+    case REPORT_WEEKLY_MACROS:
+        appendFingerprintInt(fingerprint, values.totalProteinGrams);
+        appendFingerprintInt(fingerprint, values.totalCarbGrams);
+        appendFingerprintInt(fingerprint, values.totalFatGrams);
+        break;
+    case REPORT_DAILY_MACROS:
+        appendFingerprintInt(fingerprint, values.dailyProteinGrams);
+        appendFingerprintInt(fingerprint, values.dailyCarbGrams);
+        appendFingerprintInt(fingerprint, values.dailyFatGrams);
+        appendFingerprintInt(fingerprint, values.dailyProteinCalories);
+        appendFingerprintInt(fingerprint, values.dailyCarbCalories);
+        appendFingerprintInt(fingerprint, values.dailyFatCalories);
+        break;
+    case REPORT_PER_MEAL:
+        appendFingerprintInt(fingerprint, values.proteinPerMeal);
+        appendFingerprintInt(fingerprint, values.carbsPerMeal);
+        appendFingerprintInt(fingerprint, values.fatsPerMeal);
+        break;
+    case REPORT_FOOTER:
+        appendFingerprintText(fingerprint, values.name);
+        appendFingerprintText(fingerprint, values.favoriteProtein);
+        appendFingerprintInt(fingerprint, values.dailyProteinGrams);
+        appendFingerprintDouble(fingerprint, values.weeklyWorkoutHours);
+        break;
+    default:
+        break;
+    }
+
+    return fingerprint;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that formats one section of the report.
+// ---------------------------------------------------------------------------
+string renderReportSection(const ReportValues& values, int section)
+{
+    ostringstream out;
+    out << fixed << showpoint << setprecision(2);
+
+    switch (section)
+    {
+    case REPORT_INPUTS:
+        // Report header
+        out << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
+        out << "Vegetarian Nutrition for Weightlifters Report\n";
+        out << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n\n";
+
+        out << "Information you provided:\n";
+        out << left << setw(50) << setfill('.') << "Favorite protein source: " << right << values.favoriteProtein << "\n";
+        out << left << setw(50) << setfill('.') << "Daily calorie target: " << right << values.dailyCalories << "\n";
+        out << left << setw(50) << setfill('.') << "Weekly calorie target: " << right << values.weeklyCalories << "\n";
+        out << left << setw(50) << setfill('.') << "Meals per day: " << right << values.mealsPerDay << "\n";
+        out << left << setw(50) << setfill('.') << "Weekly workout hours: " << right << values.weeklyWorkoutHours << "\n\n";
+        break;
+
+    case REPORT_WEEKLY_MACROS:
+        out << "Suggested weekly macros:\n";
+        out << left << setw(50) << setfill('.') << "Protein: " << right << values.totalProteinGrams << " grams\n";
+        out << left << setw(50) << setfill('.') << "Carbs: " << right << values.totalCarbGrams << " grams\n";
+        out << left << setw(50) << setfill('.') << "Fats: " << right << values.totalFatGrams << " grams\n\n";
+        break;
+
+    case REPORT_DAILY_MACROS:
+        out << "Suggested total daily macros:\n";
+        out << left << setw(50) << setfill('.') << "Protein: " << right << values.dailyProteinGrams << " grams (" << values.dailyProteinCalories << " cal)\n";
+        out << left << setw(50) << setfill('.') << "Carbs: " << right << values.dailyCarbGrams << " grams (" << values.dailyCarbCalories << " cal)\n";
+        out << left << setw(50) << setfill('.') << "Fats: " << right << values.dailyFatGrams << " grams (" << values.dailyFatCalories << " cal)\n\n";
+        break;
+
+    case REPORT_PER_MEAL:
+        out << "Per meal macro targets:\n";
+        out << left << setw(50) << setfill('.') << "Protein grams per meal: " << right << values.proteinPerMeal << "\n";
+        out << left << setw(50) << setfill('.') << "Carbs grams per meal: " << right << values.carbsPerMeal << "\n";
+        out << left << setw(50) << setfill('.') << "Fats grams per meal:  " << right << values.fatsPerMeal << "\n\n";
+        break;
+
+    case REPORT_FOOTER:
+        out << setfill('*') << setw(CONSOLE_WIDTH) << '*' << "\n";
+        out << "Keep fueling with " << values.favoriteProtein << " to hit " << values.dailyProteinGrams << " grams of protein daily!\n";
+        out << "Remember your " << values.weeklyWorkoutHours << " hours of weightlifting per week...\n";
+        out << "Keep lifting heavy, " << values.name << "!\n\n";
+        break;
+
+    default:
+        break;
+    }
+
+    return convertReportLineEndings(out.str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that changes each line break in rendered text to
+//     REPORT_LINE_ENDING. Reports are written in binary mode (so offsets in
+//     the index are exact), which means the line breaks a text mode stream
+//     would add have to be written out here.
+// ---------------------------------------------------------------------------
+string convertReportLineEndings(const string& text)
+{
+    string converted;
+    converted.reserve(text.length() + text.length() / 16);
+
+    for (size_t index = 0; index < text.length(); ++index)
+    {
+        if (text[index] == '\n')
+            converted += REPORT_LINE_ENDING;
+        else
+            converted += text[index];
+    }
+
+    return converted;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads a report index file.
+// The first line is REPORT_INDEX_MAGIC and the section count, then one
+//     "offset length inputHash inputCheck textHash" line per section.
+//     Returns false if the file is missing, from an older version, or
+//     incomplete.
+// ---------------------------------------------------------------------------
+bool loadReportIndex(string indexFileName, vector<ReportSectionIndex>& index)
+{
+    ifstream inFile(indexFileName);
+    string magic;
+    long long sectionCount = 0;
+
+    index.clear();
+
+    if (!inFile || !(inFile >> magic >> sectionCount) || magic != REPORT_INDEX_MAGIC || sectionCount < 0)
+        return false;
+
+    index.resize(static_cast<size_t>(sectionCount));
+
+    for (size_t section = 0; section < index.size(); ++section)
+    {
+        ReportSectionIndex& entry = index[section];
+
+        if (!(inFile >> entry.offset >> entry.length >> entry.inputHash >> entry.inputCheck >> entry.textHash) ||
+            entry.offset < 0 || entry.length < 0)
+        {
+            index.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a report index file. The index is written to a
+//     temporary file first so a partly written index is never read back.
+// ---------------------------------------------------------------------------
+bool saveReportIndex(string indexFileName,
+    const vector<ReportSectionIndex>& index)
+{
+    string tempFileName = indexFileName + TEMP_FILE_EXTENSION;
+    ofstream outFile(tempFileName);
+
+    if (!outFile)
+        return false;
+
+    outFile << REPORT_INDEX_MAGIC << ' ' << index.size() << "\n";
+
+    for (size_t section = 0; section < index.size(); ++section)
+    {
+        const ReportSectionIndex& entry = index[section];
+
+        outFile << entry.offset << ' ' << entry.length << ' ' << entry.inputHash << ' '
+            << entry.inputCheck << ' ' << entry.textHash << "\n";
+    }
+
+    outFile.close();
+
+    if (outFile.fail())
+        return false;
+
+    remove(indexFileName.c_str());
+    return rename(tempFileName.c_str(), indexFileName.c_str()) == 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes one or more reports (packed one after another) to a
+//     file, rewriting only the sections whose inputs changed since the last
+//     run.
+// The index next to the report records each section's offset, length, input
+//     hashes, and text hash. A section is reused only if both input hashes
+//     match and its bytes in the old file still hash to the recorded text
+//     hash; anything else is re-rendered. When every re-rendered section keeps
+//     its length, those sections are overwritten in place. Otherwise the file
+//     is rebuilt, with unchanged sections copied from the old file.
+// Returns false if the report cannot be written.
+// ---------------------------------------------------------------------------
+bool writeReportSections(RenderCache& renderCache, string fileName,
+    const vector<ReportValues>& reports, long long& sectionsRewritten)
+{
+    string indexFileName = fileName + REPORT_INDEX_EXTENSION;
+    size_t sectionCount = reports.size() * REPORT_SECTION_COUNT;
+    vector<ReportSectionIndex> oldIndex;
+    vector<ReportSectionIndex> newIndex(sectionCount);
+    vector<string> renderedSections(sectionCount);
+    vector<bool> changed(sectionCount, true);
+    long long offset = 0;
+
+    sectionsRewritten = 0;
+
+    // The old report can only be reused if it still matches its index
+    bool canReuse = loadReportIndex(indexFileName, oldIndex) && oldIndex.size() == sectionCount;
+
+    if (canReuse && sectionCount > 0)
+    {
+        ifstream oldFile(fileName, ios::binary | ios::ate);
+        canReuse = oldFile && static_cast<long long>(oldFile.tellg()) ==
+            oldIndex.back().offset + oldIndex.back().length;
+    }
+
+    bool sameLayout = canReuse;
+    ifstream oldFile;
+
+    if (canReuse)
+        oldFile.open(fileName, ios::binary);
+
+    // Render only the sections whose inputs or text on disk changed
+    for (size_t index = 0; index < sectionCount; ++index)
+    {
+        const ReportValues& values = reports[index / REPORT_SECTION_COUNT];
+        int section = static_cast<int>(index % REPORT_SECTION_COUNT);
+        string fingerprint = buildReportSectionFingerprint(values, section);
+
+        newIndex[index].inputHash = hashFingerprint(fingerprint);
+        newIndex[index].inputCheck = checkFingerprint(fingerprint);
+
+        if (canReuse && newIndex[index].inputHash == oldIndex[index].inputHash &&
+            newIndex[index].inputCheck == oldIndex[index].inputCheck)
+        {
+            // Sections can be edited on disk without changing the file size
+            renderedSections[index].resize(static_cast<size_t>(oldIndex[index].length));
+            oldFile.seekg(oldIndex[index].offset);
+
+            if (oldFile.read(&renderedSections[index][0], oldIndex[index].length) &&
+                hashFingerprint(renderedSections[index]) == oldIndex[index].textHash)
+            {
+                changed[index] = false;
+            }
+
+            oldFile.clear();
+        }
+
+        if (changed[index])
+        {
+            const string* cached = findRenderedOutput(renderCache, fingerprint);
+
+            if (cached != nullptr)
+                renderedSections[index] = *cached;
+            else
+            {
+                renderedSections[index] = renderReportSection(values, section);
+                storeRenderedOutput(renderCache, fingerprint, renderedSections[index]);
+            }
+
+            sectionsRewritten++;
+
+            if (canReuse && static_cast<long long>(renderedSections[index].length()) != oldIndex[index].length)
+                sameLayout = false;
+        }
+
+        newIndex[index].length = static_cast<long long>(renderedSections[index].length());
+        newIndex[index].textHash = hashFingerprint(renderedSections[index]);
+        newIndex[index].offset = offset;
+        offset += newIndex[index].length;
+    }
+
+    if (oldFile.is_open())
+        oldFile.close();
+
+    if (sameLayout)
+    {
+        // Every section keeps its place, so overwrite the changed ones in place
+        if (sectionsRewritten == 0)
+            return true;
+
+        fstream reportFile(fileName, ios::in | ios::out | ios::binary);
+
+        if (!reportFile)
+            return false;
+
+        // Drop the old index first so a crash mid-write forces a full rebuild
+        // instead of leaving old hashes next to new text
+        remove(indexFileName.c_str());
+
+        for (size_t index = 0; index < sectionCount; ++index)
+        {
+            if (changed[index])
+            {
+                reportFile.seekp(newIndex[index].offset);
+                reportFile.write(renderedSections[index].data(), renderedSections[index].length());
+            }
+        }
+
+        reportFile.close();
+
+        if (reportFile.fail())
+            return false;
+    }
+    else
+    {
+        // Rebuild the report in a temporary file, then replace the old one.
+        // Unchanged sections were already read (and checked) from the old file.
+        string tempFileName = fileName + TEMP_FILE_EXTENSION;
+        ofstream outFile(tempFileName, ios::binary | ios::trunc);
+
+        if (!outFile)
+            return false;
+
+        for (size_t index = 0; index < sectionCount; ++index)
+            outFile.write(renderedSections[index].data(), renderedSections[index].length());
+
+        outFile.close();
+
+        if (outFile.fail())
+            return false;
+
+        // Drop the old index first so a crash here forces a full rebuild.
+        // The report itself is replaced in one step, so it never goes missing.
+        remove(indexFileName.c_str());
+
+        if (!MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+            return false;
+    }
+
+    return saveReportIndex(indexFileName, newIndex);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --reports batch mode. Writes every member's report into
+//     one packed report file, rewriting only the sections that changed.
+// ---------------------------------------------------------------------------
+int runReportsMode(string membersFile, string reportFile)
+{
+    vector<MemberProfile> members;
+    RenderCache renderCache;
+    long long sectionsRewritten = 0;
+
+    if (!loadMemberProfiles(membersFile, members))
+        return 1;
+
+    initRenderCache(renderCache, RENDER_CACHE_BYTE_LIMIT);
+    vector<ReportValues> reports(members.size());
+
+    for (size_t index = 0; index < members.size(); ++index)
+        buildReportValues(members[index], reports[index]);
+
+    auto startTime = chrono::steady_clock::now();
+
+    if (!writeReportSections(renderCache, reportFile, reports, sectionsRewritten))
+    {
+        printErrorMessage("Unable to write " + reportFile);
+        return 1;
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    printSummaryLabel("Reports: ") << reports.size() << "\n";
+    printSummaryLabel("Sections rewritten: ") << sectionsRewritten
+        << " of " << reports.size() * REPORT_SECTION_COUNT << "\n";
+    printSummaryLabel("Rendered section cache hits: ") << renderCache.hits << "\n";
+    printElapsedSummary(elapsed.count(), static_cast<double>(reports.size()), "Reports");
+
+    return 0;
+}
+
+
+// ======================= STREAMING EXPORT DEFINITIONS ======================
+
+// ---------------------------------------------------------------------------
+// Function that sends everything in the export buffer to the output stream.
+// ---------------------------------------------------------------------------
+void flushExportWriter(ExportWriter& writer)
+{
+    if (writer.used > 0)
+        writer.out->write(writer.buffer, writer.used);
+
+    writer.used = 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that appends raw bytes to the export buffer, flushing whenever
+//     the buffer fills up.
+// ---------------------------------------------------------------------------
+void writeExportBytes(ExportWriter& writer, const char* bytes, int count)
+{
+    while (count > 0)
+    {
+        int space = EXPORT_BUFFER_SIZE - writer.used;
+        int chunk = (count < space) ? count : space;
+
+        memcpy(writer.buffer + writer.used, bytes, chunk);
+        writer.used += chunk;
+        bytes += chunk;
+        count -= chunk;
+
+        if (writer.used == EXPORT_BUFFER_SIZE)
+            flushExportWriter(writer);
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes an integer as decimal text.
+// ---------------------------------------------------------------------------
+void writeExportInt(ExportWriter& writer, long long value)
+{
+    char digits[24];
+    int position = sizeof(digits);
+    unsigned long long magnitude = (value < 0) ? 0ULL - static_cast<unsigned long long>(value)
+        : static_cast<unsigned long long>(value);
+
+    // Fill the digits from the right
+    do
+    {
+        digits[--position] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0)
+        digits[--position] = '-';
+
+    writeExportBytes(writer, digits + position, static_cast<int>(sizeof(digits)) - position);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that rounds a value to hundredths exactly as the report's
+//     two-decimal formatting does, so exported hours match the report text.
+// ---------------------------------------------------------------------------
+long long roundToHundredths(double value)
+{
+    char text[64];
+    long long hundredths = 0;
+    bool negative = false;
+
+    snprintf(text, sizeof(text), "%.2f", value);
+
+    for (const char* character = text; *character != '\0'; ++character)
+    {
+        if (*character == '-')
+            negative = true;
+        else if (*character >= '0' && *character <= '9')
+            hundredths = hundredths * 10 + (*character - '0');
+    }
+
+    return negative ? -hundredths : hundredths;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a value with two decimal places (for example 5.00).
+// ---------------------------------------------------------------------------
+void writeExportHundredths(ExportWriter& writer, double value)
+{
+    long long hundredths = roundToHundredths(value);
+    char fraction[3];
+
+    if (hundredths < 0)
+    {
+        writeExportBytes(writer, "-", 1);
+        hundredths = -hundredths;
+    }
+
+    writeExportInt(writer, hundredths / 100);
+
+    fraction[0] = '.';
+    fraction[1] = static_cast<char>('0' + (hundredths / 10) % 10);
+    fraction[2] = static_cast<char>('0' + hundredths % 10);
+    writeExportBytes(writer, fraction, 3);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a CSV field, quoting it only when it contains a
+//     comma, quote, or line break.
+// ---------------------------------------------------------------------------
+void writeExportCsvText(ExportWriter& writer, const string& text)
+{
+    if (text.find_first_of(",\"\r\n") == string::npos)
+    {
+        writeExportBytes(writer, text.data(), static_cast<int>(text.length()));
+        return;
+    }
+
+    writeExportBytes(writer, "\"", 1);
+
+    for (size_t index = 0; index < text.length(); ++index)
+    {
+        // Quotes inside a quoted field are doubled
+        if (text[index] == '"')
+            writeExportBytes(writer, "\"", 1);
+        writeExportBytes(writer, &text[index], 1);
+    }
+
+    writeExportBytes(writer, "\"", 1);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a JSON string with quotes, backslashes, and control
+//     characters escaped.
+// ---------------------------------------------------------------------------
+void writeExportJsonText(ExportWriter& writer, const string& text)
+{
+    const char hexDigits[] = "0123456789abcdef";
+
+    writeExportBytes(writer, "\"", 1);
+
+    for (size_t index = 0; index < text.length(); ++index)
+    {
+        unsigned char character = static_cast<unsigned char>(text[index]);
+
+        if (character == '"' || character == '\\')
+        {
+            char escaped[2] = {'\\', static_cast<char>(character)};
+            writeExportBytes(writer, escaped, 2);
+        }
+        else if (character < 0x20)
+        {
+            char escaped[6] = {'\\', 'u', '0', '0', hexDigits[character >> 4], hexDigits[character & 0x0F]};
+            writeExportBytes(writer, escaped, 6);
+        }
+        else
+        {
+            writeExportBytes(writer, &text[index], 1);
+        }
+    }
+
+    writeExportBytes(writer, "\"", 1);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a text field of a binary record: exactly
+//     EXPORT_NAME_BYTES bytes, truncated or padded with zero bytes.
+// Text is cut at the start of a UTF-8 character, never in the middle of one,
+//     so a cut field may hold fewer than EXPORT_NAME_BYTES bytes of text.
+// ---------------------------------------------------------------------------
+void writeExportBinaryText(ExportWriter& writer, const string& text)
+{
+    char field[EXPORT_NAME_BYTES] = {};
+    size_t length = (text.length() < sizeof(field)) ? text.length() : sizeof(field);
+
+    // Back up while the first byte left out continues a character
+    while (length < text.length() && length > 0 &&
+        (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80)
+    {
+        --length;
+    }
+
+    memcpy(field, text.data(), length);
+    writeExportBytes(writer, field, EXPORT_NAME_BYTES);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a 32-bit integer field of a binary record in
+//     little-endian byte order.
+// ---------------------------------------------------------------------------
+void writeExportBinaryInt(ExportWriter& writer, int value)
+{
+    unsigned int bits = static_cast<unsigned int>(value);
+    char bytes[4];
+
+    for (int index = 0; index < 4; ++index)
+        bytes[index] = static_cast<char>((bits >> (8 * index)) & 0xFF);
+
+    writeExportBytes(writer, bytes, 4);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes what comes before the first record: the column
+//     names for CSV, or the magic bytes and record size for binary.
+// ---------------------------------------------------------------------------
+void writeExportHeader(ExportWriter& writer, ExportFormat format)
+{
+    const char csvHeader[] =
+        "name,favorite_protein,daily_calories,weekly_calories,meals_per_day,"
+        "weekly_workout_hours,daily_protein_grams,daily_carb_grams,daily_fat_grams,"
+        "daily_protein_calories,daily_carb_calories,daily_fat_calories,"
+        "weekly_protein_grams,weekly_carb_grams,weekly_fat_grams,"
+        "protein_per_meal,carbs_per_meal,fats_per_meal\n";
+
+    if (format == EXPORT_CSV)
+    {
+        writeExportBytes(writer, csvHeader, static_cast<int>(sizeof(csvHeader)) - 1);
+    }
+    else if (format == EXPORT_BINARY)
+    {
+        writeExportBytes(writer, EXPORT_BINARY_MAGIC, sizeof(EXPORT_BINARY_MAGIC));
+        writeExportBinaryInt(writer, EXPORT_RECORD_BYTES);
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes one member's report values as a record.
+// Every format holds the same fields in the same order as the CSV header.
+// Binary records are EXPORT_RECORD_BYTES long: two fixed text fields, then
+//     16 little-endian 32-bit integers (workout hours in hundredths).
+// ---------------------------------------------------------------------------
+void writeExportRecord(ExportWriter& writer, ExportFormat format,
+    const ReportValues& values)
+{
+    const int intFields[EXPORT_INT_FIELD_COUNT] = {
+        values.dailyCalories, values.weeklyCalories, values.mealsPerDay,
+        static_cast<int>(roundToHundredths(values.weeklyWorkoutHours)),
+        values.dailyProteinGrams, values.dailyCarbGrams, values.dailyFatGrams,
+        values.dailyProteinCalories, values.dailyCarbCalories, values.dailyFatCalories,
+        values.totalProteinGrams, values.totalCarbGrams, values.totalFatGrams,
+        values.proteinPerMeal, values.carbsPerMeal, values.fatsPerMeal};
+
+    // JSON Lines keys, in field order (the hours key is handled separately)
+    const char* const jsonKeys[EXPORT_INT_FIELD_COUNT] = {
+        ",\"daily_calories\":", ",\"weekly_calories\":", ",\"meals_per_day\":",
+        ",\"weekly_workout_hours\":",
+        ",\"daily_protein_grams\":", ",\"daily_carb_grams\":", ",\"daily_fat_grams\":",
+        ",\"daily_protein_calories\":", ",\"daily_carb_calories\":", ",\"daily_fat_calories\":",
+        ",\"weekly_protein_grams\":", ",\"weekly_carb_grams\":", ",\"weekly_fat_grams\":",
+        ",\"protein_per_meal\":", ",\"carbs_per_meal\":", ",\"fats_per_meal\":"};
+
+    const int HOURS_FIELD = 3;
+
+    switch (format)
+    {
+    case EXPORT_CSV:
+        writeExportCsvText(writer, values.name);
+        writeExportBytes(writer, ",", 1);
+        writeExportCsvText(writer, values.favoriteProtein);
+
+        for (int field = 0; field < EXPORT_INT_FIELD_COUNT; ++field)
+        {
+            writeExportBytes(writer, ",", 1);
+
+            if (field == HOURS_FIELD)
+                writeExportHundredths(writer, values.weeklyWorkoutHours);
+            else
+                writeExportInt(writer, intFields[field]);
+        }
+
+        writeExportBytes(writer, "\n", 1);
+        break;
+
+    case EXPORT_JSON_LINES:
+        writeExportBytes(writer, "{\"name\":", 8);
+        writeExportJsonText(writer, values.name);
+        writeExportBytes(writer, ",\"favorite_protein\":", 20);
+        writeExportJsonText(writer, values.favoriteProtein);
+
+        for (int field = 0; field < EXPORT_INT_FIELD_COUNT; ++field)
+        {
+            writeExportBytes(writer, jsonKeys[field], static_cast<int>(strlen(jsonKeys[field])));
+
+            if (field == HOURS_FIELD)
+                writeExportHundredths(writer, values.weeklyWorkoutHours);
+            else
+                writeExportInt(writer, intFields[field]);
+        }
+
+        writeExportBytes(writer, "}\n", 2);
+        break;
+
+    case EXPORT_BINARY:
+        writeExportBinaryText(writer, values.name);
+        writeExportBinaryText(writer, values.favoriteProtein);
+
+        for (int field = 0; field < EXPORT_INT_FIELD_COUNT; ++field)
+            writeExportBinaryInt(writer, intFields[field]);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --export batch mode. Streams every member's report values
+//     to a file, or to standard output when the file name is "-".
+// Members are read, converted, and written one at a time. A file is written
+//     under a temporary name and only replaces outputFile once complete.
+// The values come from buildReportValues, the same calculation the text
+//     report uses.
+// ---------------------------------------------------------------------------
+int runExportMode(string formatName, string membersFile, string outputFile)
+{
+    MemberProfileReader reader;
+    MemberProfile member;
+    ExportFormat format;
+    ofstream outFile;
+    ReportValues values;
+    string tempFileName = outputFile + TEMP_FILE_EXTENSION;
+
+    if (formatName == "csv")
+        format = EXPORT_CSV;
+    else if (formatName == "jsonl")
+        format = EXPORT_JSON_LINES;
+    else if (formatName == "binary")
+        format = EXPORT_BINARY;
+    else
+    {
+        printErrorMessage("Unknown export format " + formatName + " (use csv, jsonl, or binary)");
+        return 1;
+    }
+
+    if (!openMemberProfiles(membersFile, reader))
+        return 1;
+
+    // The buffer is large, so keep the writer off the stack
+    unique_ptr<ExportWriter> writer(new ExportWriter);
+    writer->used = 0;
+
+    if (outputFile == "-")
+    {
+        // Stop Windows from turning "\n" into "\r\n" on standard output
+        cout.flush();
+        _setmode(_fileno(stdout), _O_BINARY);
+        writer->out = &cout;
+    }
+    else
+    {
+        outFile.open(tempFileName, ios::binary | ios::trunc);
+
+        if (!outFile)
+        {
+            printErrorMessage("Unable to open " + tempFileName);
+            return 1;
+        }
+
+        writer->out = &outFile;
+    }
+
+    writeExportHeader(*writer, format);
+
+    while (readMemberProfile(reader, member))
+    {
+        buildReportValues(member, values);
+        writeExportRecord(*writer, format, values);
+    }
+
+    flushExportWriter(*writer);
+    writer->out->flush();
+
+    if (outFile.is_open())
+        outFile.close();
+
+    // Records already on standard output cannot be taken back, but a
+    // partly written file is never left under the output name
+    if (reader.invalidLine || reader.readFailed)
+    {
+        if (outputFile != "-")
+            remove(tempFileName.c_str());
+        return 1;
+    }
+
+    if (writer->out->fail() ||
+        (outputFile != "-" && !MoveFileExA(tempFileName.c_str(), outputFile.c_str(), MOVEFILE_REPLACE_EXISTING)))
+    {
+        printErrorMessage("Unable to write " + outputFile);
+
+        if (outputFile != "-")
+            remove(tempFileName.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// ==================== SESSION RECORD AND REPLAY DEFINITIONS ================
+
+// ---------------------------------------------------------------------------
+// Function that writes a session recording. The file holds a magic line,
+//     then the input and the transcript, each as a length line followed by
+//     the raw bytes.
+// ---------------------------------------------------------------------------
+bool saveSessionRecording(string fileName, const SessionRecording& recording)
+{
+    ofstream outFile(fileName, ios::binary | ios::trunc);
+
+    if (!outFile)
+        return false;
+
+    outFile << SESSION_RECORDING_MAGIC << "\n";
+    outFile << recording.input.length() << "\n" << recording.input;
+    outFile << recording.transcript.length() << "\n" << recording.transcript;
+    outFile.close();
+
+    return !outFile.fail();
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads a session recording written by saveSessionRecording.
+// Returns false if the file is missing, not a recording, or cut short.
+// ---------------------------------------------------------------------------
+bool loadSessionRecording(string fileName, SessionRecording& recording)
+{
+    ifstream inFile(fileName, ios::binary);
+    string magic;
+    size_t inputLength = 0;
+    size_t transcriptLength = 0;
+
+    if (!inFile || !getline(inFile, magic) || magic != SESSION_RECORDING_MAGIC)
+        return false;
+
+    if (!(inFile >> inputLength) || inFile.get() != '\n')
+        return false;
+
+    recording.input.resize(inputLength);
+
+    if (inputLength > 0 && !inFile.read(&recording.input[0], inputLength))
+        return false;
+
+    if (!(inFile >> transcriptLength) || inFile.get() != '\n')
+        return false;
+
+    recording.transcript.resize(transcriptLength);
+
+    if (transcriptLength > 0 && !inFile.read(&recording.transcript[0], transcriptLength))
+        return false;
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that compares two transcripts.
+// Returns the line number (starting at 1) of the first difference, or 0 if
+//     they are identical.
+// ---------------------------------------------------------------------------
+int findFirstDifferentLine(const string& expected, const string& actual)
+{
+    int line = 1;
+    size_t shorter = (expected.length() < actual.length()) ? expected.length() : actual.length();
+
+    for (size_t index = 0; index < shorter; ++index)
+    {
+        if (expected[index] != actual[index])
+            return line;
+
+        if (expected[index] == '\n')
+            ++line;
+    }
+
+    return (expected.length() == actual.length()) ? 0 : line;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that swaps every mention of the report file a recorded or
+//     replayed session actually wrote for REPORT_FILE_NAME, so transcripts
+//     compare equal no matter where each run sent its report.
+// ---------------------------------------------------------------------------
+string normalizeReportFileName(string transcript, const string& reportFileName)
+{
+    size_t position = 0;
+
+    if (reportFileName == REPORT_FILE_NAME)
+        return transcript;
+
+    while ((position = transcript.find(reportFileName, position)) != string::npos)
+    {
+        transcript.replace(position, reportFileName.length(), REPORT_FILE_NAME);
+        position += REPORT_FILE_NAME.length();
+    }
+
+    return transcript;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --record mode. Runs a normal interactive session while
+//     keeping a copy of everything typed and printed, then saves both.
+// The session's report goes to <recording>.report.txt instead of report.txt,
+//     so replays can check the report as well as the transcript.
+// ---------------------------------------------------------------------------
+int runRecordMode(string recordingFile)
+{
+    SessionRecording recording;
+    RecordingInputBuffer inputBuffer;
+    RecordingOutputBuffer outputBuffer;
+
+    // Start from no report, as a replay does
+    activeReportFileName = recordingFile + RECORDED_REPORT_EXTENSION;
+    remove(activeReportFileName.c_str());
+    remove((activeReportFileName + REPORT_INDEX_EXTENSION).c_str());
+
+    inputBuffer.source = cin.rdbuf();
+    inputBuffer.recorded = &recording.input;
+    outputBuffer.destination = cout.rdbuf();
+    outputBuffer.recorded = &recording.transcript;
+
+    streambuf* originalInput = cin.rdbuf(&inputBuffer);
+    streambuf* originalOutput = cout.rdbuf(&outputBuffer);
+
+    runInteractiveSession();
+
+    cout.flush();
+    cin.rdbuf(originalInput);
+    cout.rdbuf(originalOutput);
+
+    // Only the report itself is kept with the recording
+    remove((activeReportFileName + REPORT_INDEX_EXTENSION).c_str());
+    recording.transcript = normalizeReportFileName(recording.transcript, activeReportFileName);
+    activeReportFileName = REPORT_FILE_NAME;
+
+    if (!saveSessionRecording(recordingFile, recording))
+    {
+        printErrorMessage("Unable to write " + recordingFile);
+        return 1;
+    }
+
+    setConsoleColor(COLOR_SUB_HEADING);
+    cout << "Session recorded to " << recordingFile << "\n";
+    setConsoleColor(COLOR_DEFAULT);
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --replay mode. Runs each recorded session in this
+//     process, feeding it the recorded input and capturing its output, then
+//     reports the time each session took and any difference from the
+//     recorded transcript, or from <recording>.report.txt if there is one.
+// Returns 0 only if every session matched its recording.
+// ---------------------------------------------------------------------------
+int runReplayMode(int fileCount, char* fileNames[])
+{
+    streambuf* originalInput = cin.rdbuf();
+    streambuf* originalOutput = cout.rdbuf();
+    ios_base::iostate originalExceptions = cin.exceptions();
+    ios originalFormat(nullptr);
+
+    int matchedCount = 0;
+    double totalMilliseconds = 0.0;
+    double slowestMilliseconds = 0.0;
+
+    originalFormat.copyfmt(cout);
+    consoleColorsEnabled = false;
+
+    // Reports from replayed sessions go to a scratch file in the temp folder
+    char tempPath[MAX_PATH];
+    DWORD tempPathLength = GetTempPathA(MAX_PATH, tempPath);
+
+    activeReportFileName = string((tempPathLength > 0 && tempPathLength < MAX_PATH) ? tempPath : "")
+        + "replay_" + REPORT_FILE_NAME;
+
+    for (int file = 0; file < fileCount; ++file)
+    {
+        SessionRecording recording;
+        ReplayInputBuffer inputBuffer;
+        ostringstream output;
+        bool inputRanOut = false;
+
+        if (!loadSessionRecording(fileNames[file], recording))
+        {
+            printErrorMessage("Unable to read recording " + string(fileNames[file]));
+            continue;
+        }
+
+        inputBuffer.input = &recording.input;
+        inputBuffer.position = 0;
+
+        // Every session starts without a report, as it did when recorded
+        remove(activeReportFileName.c_str());
+        remove((activeReportFileName + REPORT_INDEX_EXTENSION).c_str());
+
+        // Swap in the recorded input and capture the output. A bad stream
+        // throws so a replay that runs out of input stops right away.
+        cin.rdbuf(&inputBuffer);
+        cin.clear();
+        cin.exceptions(ios::badbit);
+        cout.rdbuf(output.rdbuf());
+
+        auto startTime = chrono::steady_clock::now();
+
+        try
+        {
+            runInteractiveSession();
+        }
+        catch (const ios_base::failure&)
+        {
+            inputRanOut = true;
+        }
+
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - startTime;
+
+        // Put the real console back, including any formatting the session changed
+        cin.exceptions(originalExceptions);
+        cin.rdbuf(originalInput);
+        cin.clear();
+        cout.rdbuf(originalOutput);
+        cout.copyfmt(originalFormat);
+
+        int differentLine = findFirstDifferentLine(recording.transcript,
+            normalizeReportFileName(output.str(), activeReportFileName));
+
+        // Compare the report only when one was saved with the recording
+        string expectedReportFile = string(fileNames[file]) + RECORDED_REPORT_EXTENSION;
+        ifstream expectedReport(expectedReportFile, ios::binary);
+        bool reportMatches = true;
+
+        if (expectedReport)
+        {
+            ifstream actualReport(activeReportFileName, ios::binary);
+            ostringstream expectedText;
+            ostringstream actualText;
+
+            expectedText << expectedReport.rdbuf();
+            if (actualReport)
+                actualText << actualReport.rdbuf();
+
+            reportMatches = actualReport && expectedText.str() == actualText.str();
+        }
+
+        totalMilliseconds += elapsed.count();
+        if (elapsed.count() > slowestMilliseconds)
+            slowestMilliseconds = elapsed.count();
+
+        cout << fixed << showpoint << setprecision(3);
+        printSummaryLabel(string(fileNames[file]) + " ") << elapsed.count() << " ms  ";
+
+        if (inputRanOut)
+            cout << "INPUT RAN OUT (output differs from line " << differentLine << ")\n";
+        else if (differentLine != 0)
+            cout << "DIFFERS at line " << differentLine << "\n";
+        else if (!reportMatches)
+            cout << "REPORT DIFFERS from " << expectedReportFile << "\n";
+        else
+        {
+            cout << "OK\n";
+            ++matchedCount;
+        }
+    }
+
+    consoleColorsEnabled = true;
+
+    remove((activeReportFileName + REPORT_INDEX_EXTENSION).c_str());
+    remove(activeReportFileName.c_str());
+    activeReportFileName = REPORT_FILE_NAME;
+
+    cout << fixed << showpoint << setprecision(3);
+    printSummaryLabel("Sessions matched: ") << matchedCount << " of " << fileCount << "\n";
+    printSummaryLabel("Total replay time: ") << totalMilliseconds << " ms\n";
+
+    if (fileCount > 0)
+        printSummaryLabel("Average session time: ") << totalMilliseconds / fileCount << " ms\n";
+
+    printSummaryLabel("Slowest session time: ") << slowestMilliseconds << " ms\n";
+
+    return (matchedCount == fileCount) ? 0 : 1;
+}
+
+
+// ======================= WEIGHT PROJECTION DEFINITIONS =====================
+
+// ---------------------------------------------------------------------------
+// Function to display menu option 7.
+// Runs the Monte Carlo projection and shows the likely range of weight
+//     change every few weeks.
+// ---------------------------------------------------------------------------
+void displayWeightProjection(int dailyCalories, double weeklyWorkoutHours,
+    GoalType goal, const int dailyCaloriesLog[])
+{
+    vector<WeightProjectionBand> bands;
+    int threadCount = static_cast<int>(thread::hardware_concurrency());
+
+    projectWeightTrajectory(dailyCalories, weeklyWorkoutHours, goal,
+        dailyCaloriesLog, PROJECTION_WEEKS, PROJECTION_TABLE_INTERVAL,
+        PROJECTION_SIMULATIONS, threadCount, PROJECTION_SEED, bands);
+
+    setConsoleColor(COLOR_SUB_HEADING);
+    printSectionBreakLine();
+    cout << "Projecting your weight over the next " << PROJECTION_WEEKS << " weeks...\n\n";
+    setConsoleColor(COLOR_DEFAULT);
+
+    cout << "Based on " << PROJECTION_SIMULATIONS << " simulated futures using your weekly calorie log,\n"
+        << "your workout hours, and an estimated maintenance of "
+        << estimateMaintenanceCalories(dailyCalories, goal) << " calories per day.\n\n";
+
+    cout << left << setw(10) << "Week" << right << setw(15) << "Low (10%)"
+        << setw(15) << "Likely" << setw(15) << "High (90%)" << "\n";
+    printSectionBreakLine();
+
+    for (size_t row = 0; row < bands.size(); ++row)
+    {
+        const WeightProjectionBand& band = bands[row];
+
+        cout << left << setw(10) << (row + 1) * PROJECTION_TABLE_INTERVAL << right << showpos
+            << setw(11) << band.low << " lbs"
+            << setw(11) << band.median << " lbs"
+            << setw(11) << band.high << " lbs" << noshowpos << "\n";
+    }
+
+    cout << "\n";
+    setConsoleColor(COLOR_SUB_HEADING);
+    printSectionBreakLine();
+    setConsoleColor(COLOR_DEFAULT);
+    cout << endl;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that estimates maintenance calories from the daily target.
+// The target is assumed to already include the deficit or surplus that
+//     matches the user's goal.
+// ---------------------------------------------------------------------------
+int estimateMaintenanceCalories(int dailyCalories, GoalType goal)
+{
+    switch (goal)
+    {
+    case FAT_LOSS:
+        return dailyCalories + FAT_LOSS_DEFICIT;
+    case MUSCLE_GAIN:
+        return dailyCalories - MUSCLE_GAIN_SURPLUS;
+    default:
+        return dailyCalories;
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that scrambles a 32-bit value (the "lowbias32" integer hash).
+// It uses only 32-bit shifts and multiplies, which vectorize well.
+// ---------------------------------------------------------------------------
+unsigned int mixCounter(unsigned int value)
+{
+    value ^= value >> 16;
+    value *= 0x7FEB352DU;
+    value ^= value >> 15;
+    value *= 0x846CA68BU;
+    value ^= value >> 16;
+    return value;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that turns a counter into an approximately normal random number
+//     (mean 0, standard deviation 1).
+// Any draw can be computed directly from its counter, so threads and vector
+//     lanes need no shared generator state and results do not depend on the
+//     thread count. Two hashes give four 16-bit uniform values, which are
+//     summed (Irwin-Hall) to get a bell-shaped value.
+// The counter is hashed with both halves of the 64-bit key. The low half is
+//     scrambled first, so keys a small step apart give unrelated draws
+//     instead of the same draws at a shifted counter.
+// ---------------------------------------------------------------------------
+float counterNormal(unsigned long long key, unsigned int counter)
+{
+    unsigned int keyLow = mixCounter(static_cast<unsigned int>(key));
+    unsigned int keyHigh = static_cast<unsigned int>(key >> 32);
+    unsigned int first = mixCounter(mixCounter((counter * 2) ^ keyLow) ^ keyHigh);
+    unsigned int second = mixCounter(mixCounter((counter * 2 + 1) ^ keyLow) ^ keyHigh);
+
+    float sum = static_cast<float>(static_cast<int>(first & 0xFFFF) + static_cast<int>(first >> 16) +
+        static_cast<int>(second & 0xFFFF) + static_cast<int>(second >> 16));
+
+    // Sum of four uniforms has mean 2 and variance 1/3
+    return (sum * (1.0f / 65536.0f) - 2.0f) * 1.7320508f;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that simulates the weight change for simulations
+//     firstSimulation up to (not including) lastSimulation.
+// Each simulated day draws an intake around the logged average. Each week
+//     draws the training time, and extra or missed hours change the calories
+//     burned. The planned hours are assumed to be part of maintenance
+//     already, so only the spread around the plan is modelled: the training
+//     term averages zero and widens the bands without moving the median.
+// Simulations are stepped PROJECTION_LANES at a time through plain arrays
+//     so the compiler can vectorize the inner loops.
+// Only every bandInterval-th week is stored, one row per stored week:
+//     weightChanges[row * simulations + simulation].
+// ---------------------------------------------------------------------------
+void simulateWeightChange(unsigned long long key, int firstSimulation,
+    int lastSimulation, int simulations, int weeks, int bandInterval,
+    float intakeMean, float intakeSpread, float maintenanceCalories,
+    float weeklyWorkoutHours, float weightChanges[])
+{
+    const unsigned int drawsPerWeek = NUMBER_OF_DAYS + 1;
+
+    for (int block = firstSimulation; block < lastSimulation; block += PROJECTION_LANES)
+    {
+        int lanes = (lastSimulation - block < PROJECTION_LANES) ? lastSimulation - block : PROJECTION_LANES;
+        float change[PROJECTION_LANES] = {};
+
+        for (int week = 0; week < weeks; ++week)
+        {
+            float balance[PROJECTION_LANES];
+            unsigned int counters[PROJECTION_LANES];
+
+            // Training time this week (the last draw of the week)
+            for (int lane = 0; lane < PROJECTION_LANES; ++lane)
+            {
+                counters[lane] = (static_cast<unsigned int>(block + lane) * weeks + week) * drawsPerWeek;
+
+                float hours = weeklyWorkoutHours *
+                    (1.0f + static_cast<float>(WORKOUT_HOURS_VARIATION) * counterNormal(key, counters[lane] + NUMBER_OF_DAYS));
+                hours = (hours < 0.0f) ? 0.0f : hours;
+
+                balance[lane] = (weeklyWorkoutHours - hours) * static_cast<float>(CALORIES_PER_LIFTING_HOUR);
+            }
+
+            // Daily intake against maintenance
+            for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+            {
+                for (int lane = 0; lane < PROJECTION_LANES; ++lane)
+                {
+                    float intake = intakeMean + intakeSpread * counterNormal(key, counters[lane] + day);
+                    intake = (intake < 0.0f) ? 0.0f : intake;
+
+                    balance[lane] += intake - maintenanceCalories;
+                }
+            }
+
+            for (int lane = 0; lane < PROJECTION_LANES; ++lane)
+                change[lane] += balance[lane] / static_cast<float>(CALORIES_PER_POUND);
+
+            if ((week + 1) % bandInterval == 0)
+            {
+                float* row = weightChanges + static_cast<size_t>((week + 1) / bandInterval - 1) * simulations;
+
+                for (int lane = 0; lane < lanes; ++lane)
+                    row[block + lane] = change[lane];
+            }
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that projects body weight change from the calorie log and goal.
+// Simulations are split across threadCount threads. Every bandInterval
+//     weeks, the 10th, 50th, and 90th percentiles of the simulated weight
+//     change are added to bands (weeks bandInterval, 2 * bandInterval, ...).
+// The same seed always gives the same bands, whatever the thread count.
+// ---------------------------------------------------------------------------
+void projectWeightTrajectory(int dailyCalories, double weeklyWorkoutHours,
+    GoalType goal, const int dailyCaloriesLog[], int weeks, int bandInterval,
+    int simulations, int threadCount, unsigned long long seed,
+    vector<WeightProjectionBand>& bands)
+{
+    double intakeMean = calculateAverageCalories(dailyCaloriesLog, NUMBER_OF_DAYS);
+    double squaredDifferences = 0.0;
+
+    for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+        squaredDifferences += (dailyCaloriesLog[day] - intakeMean) * (dailyCaloriesLog[day] - intakeMean);
+
+    double intakeSpread = sqrt(squaredDifferences / (NUMBER_OF_DAYS - 1));
+
+    // Without a log, assume the member eats their target every day
+    if (intakeMean <= 0.0)
+    {
+        intakeMean = dailyCalories;
+        intakeSpread = 0.0;
+    }
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    int bandCount = weeks / bandInterval;
+    vector<float> weightChanges(static_cast<size_t>(bandCount) * simulations);
+    unsigned long long key = seed;
+    vector<thread> workers;
+    int blocks = (simulations + PROJECTION_LANES - 1) / PROJECTION_LANES;
+
+    if (threadCount > blocks)
+        threadCount = (blocks > 0) ? blocks : 1;
+
+    for (int worker = 0; worker < threadCount; ++worker)
+    {
+        // Each thread takes a run of whole lane blocks
+        int first = blocks * worker / threadCount * PROJECTION_LANES;
+        int last = blocks * (worker + 1) / threadCount * PROJECTION_LANES;
+        last = (last > simulations) ? simulations : last;
+
+        if (worker == threadCount - 1)
+        {
+            // The calling thread does the last share itself
+            simulateWeightChange(key, first, last, simulations, weeks, bandInterval,
+                static_cast<float>(intakeMean), static_cast<float>(intakeSpread),
+                static_cast<float>(estimateMaintenanceCalories(dailyCalories, goal)),
+                static_cast<float>(weeklyWorkoutHours), weightChanges.data());
+        }
+        else
+        {
+            workers.push_back(thread(simulateWeightChange, key, first, last, simulations, weeks, bandInterval,
+                static_cast<float>(intakeMean), static_cast<float>(intakeSpread),
+                static_cast<float>(estimateMaintenanceCalories(dailyCalories, goal)),
+                static_cast<float>(weeklyWorkoutHours), weightChanges.data()));
+        }
+    }
+
+    for (size_t worker = 0; worker < workers.size(); ++worker)
+        workers[worker].join();
+
+    // Percentiles for each stored week (each week's results are one contiguous row)
+    bands.resize(bandCount);
+
+    for (int band = 0; band < bandCount && simulations > 0; ++band)
+    {
+        float* row = weightChanges.data() + static_cast<size_t>(band) * simulations;
+        int lowIndex = static_cast<int>(PROJECTION_LOW_PERCENTILE * (simulations - 1));
+        int medianIndex = (simulations - 1) / 2;
+        int highIndex = static_cast<int>(PROJECTION_HIGH_PERCENTILE * (simulations - 1));
+
+        nth_element(row, row + medianIndex, row + simulations);
+        bands[band].median = row[medianIndex];
+        nth_element(row, row + lowIndex, row + medianIndex);
+        bands[band].low = row[lowIndex];
+        nth_element(row + medianIndex, row + highIndex, row + simulations);
+        bands[band].high = row[highIndex];
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --project batch mode. Projects every member in parallel
+//     (one member per thread at a time) and writes one CSV line per member
+//     with the band for the final week. Lines are written with the export
+//     writer, so names are quoted the same way as in --export csv.
+// ---------------------------------------------------------------------------
+int runProjectMode(string membersFile, string outputFile, int weeks,
+    int simulations)
+{
+    vector<MemberProfile> members;
+    int threadCount = static_cast<int>(thread::hardware_concurrency());
+
+    if (weeks < 1 || simulations < 1)
+    {
+        printErrorMessage("Weeks and simulations must be positive numbers");
+        return 1;
+    }
+
+    if (!loadMemberProfiles(membersFile, members))
+        return 1;
+
+    ofstream outFile(outputFile, ios::binary | ios::trunc);
+
+    if (!outFile)
+    {
+        printErrorMessage("Unable to open " + outputFile);
+        return 1;
+    }
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    vector<WeightProjectionBand> finalBands(members.size());
+    vector<thread> workers;
+    atomic<size_t> nextMember(0);
+
+    auto startTime = chrono::steady_clock::now();
+
+    for (int worker = 0; worker < threadCount; ++worker)
+    {
+        workers.push_back(thread([&]()
+        {
+            vector<WeightProjectionBand> bands;
+            size_t index;
+
+            while ((index = nextMember.fetch_add(1)) < members.size())
+            {
+                const MemberProfile& member = members[index];
+
+                // Only the final week is needed, so use it as the band interval
+                projectWeightTrajectory(member.dailyCalories, member.weeklyWorkoutHours,
+                    member.goal, member.dailyCaloriesLog, weeks, weeks, simulations, 1,
+                    PROJECTION_SEED ^ hashFingerprint(member.name), bands);
+                finalBands[index] = bands[0];
+            }
+        }));
+    }
+
+    for (size_t worker = 0; worker < workers.size(); ++worker)
+        workers[worker].join();
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    // The buffer is large, so keep the writer off the stack
+    const char csvHeader[] = "name,weeks,low_pounds,median_pounds,high_pounds\n";
+    unique_ptr<ExportWriter> writer(new ExportWriter);
+
+    writer->out = &outFile;
+    writer->used = 0;
+    writeExportBytes(*writer, csvHeader, static_cast<int>(sizeof(csvHeader)) - 1);
+
+    for (size_t index = 0; index < members.size(); ++index)
+    {
+        writeExportCsvText(*writer, members[index].name);
+        writeExportBytes(*writer, ",", 1);
+        writeExportInt(*writer, weeks);
+        writeExportBytes(*writer, ",", 1);
+        writeExportHundredths(*writer, finalBands[index].low);
+        writeExportBytes(*writer, ",", 1);
+        writeExportHundredths(*writer, finalBands[index].median);
+        writeExportBytes(*writer, ",", 1);
+        writeExportHundredths(*writer, finalBands[index].high);
+        writeExportBytes(*writer, "\n", 1);
+    }
+
+    flushExportWriter(*writer);
+    outFile.close();
+
+    printSummaryLabel("Members projected: ") << members.size() << "\n";
+    printSummaryLabel("Simulations per member: ") << simulations << "\n";
+    printElapsedSummary(elapsed.count(), static_cast<double>(members.size()), "Members");
+
+    return outFile.fail() ? 1 : 0;
+}
+
+
+// ========================= POLICY SWEEP DEFINITIONS ========================
+
+// ---------------------------------------------------------------------------
+// Function that reads one grid point from a line of the grid file.
+// Fields are separated by '|':
+//     protein|carb|fat|activity high|activity medium|
+//     cal excess|cal high|cal medium|cal low
+// Ratios are basis points of daily calories (3000 = 30 percent).
+// Returns false if any field is missing or negative, the ratios add up to
+//     more than 100 percent, or the activity or calorie thresholds are out of
+//     order (the same rules the default policy is checked against).
+// ---------------------------------------------------------------------------
+bool parseMacroPolicyLine(const string& line, MacroPolicy& policy)
+{
+    istringstream fields(line);
+    string field;
+    int* ratios[] = {&policy.proteinBasisPoints, &policy.carbBasisPoints,
+        &policy.fatBasisPoints};
+    double* activity[] = {&policy.activityHigh, &policy.activityMedium};
+    int* calories[] = {&policy.calExcess, &policy.calHigh,
+        &policy.calMedium, &policy.calLow};
+
+    for (int index = 0; index < 3; ++index)
+    {
+        if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+            !(istringstream(field) >> *ratios[index]) ||
+            *ratios[index] < 0 || *ratios[index] > BASIS_POINTS_PER_WHOLE)
+            return false;
+    }
+
+    for (int index = 0; index < 2; ++index)
+    {
+        if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+            !(istringstream(field) >> *activity[index]) || *activity[index] < 0.0)
+            return false;
+    }
+
+    for (int index = 0; index < 4; ++index)
+    {
+        if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+            !(istringstream(field) >> *calories[index]) || *calories[index] < 0)
+            return false;
+    }
+
+    if (policy.proteinBasisPoints + policy.carbBasisPoints + policy.fatBasisPoints > BASIS_POINTS_PER_WHOLE)
+        return false;
+
+    return policy.activityMedium <= policy.activityHigh && policy.calLow <= policy.calMedium &&
+        policy.calMedium <= policy.calHigh && policy.calHigh <= policy.calExcess;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that loads every grid point from the grid file.
+// Blank lines are skipped. Returns false if the file cannot be opened, a
+//     line is invalid, or the file has no grid points.
+// ---------------------------------------------------------------------------
+bool loadSweepGrid(string fileName, vector<MacroPolicy>& grid)
+{
+    ifstream inFile(fileName);
+    string line;
+    int lineNumber = 0;
+
+    if (!inFile)
+    {
+        printErrorMessage("Unable to open " + fileName);
+        return false;
+    }
+
+    while (getline(inFile, line))
+    {
+        MacroPolicy policy;
+        ++lineNumber;
+
+        if (line.length() > 0 && line[line.length() - 1] == '\r')
+            line.erase(line.length() - 1);
+
+        if (line.length() == 0)
+            continue;
+
+        if (!parseMacroPolicyLine(line, policy))
+        {
+            printErrorMessage("Invalid grid point on line " + to_string(lineNumber) + " of " + fileName);
+            return false;
+        }
+
+        grid.push_back(policy);
+    }
+
+    if (grid.size() == 0)
+    {
+        printErrorMessage(fileName + " has no grid points");
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that evaluates one block of members against every grid point
+//     and adds the results to totals (one entry per grid point).
+// The block is read once from memory and stays in cache for all the grid
+//     points, so the members are only scanned once per sweep.
+// ---------------------------------------------------------------------------
+void sweepMemberBlock(const vector<MacroPolicy>& grid,
+    const SweepMember members[], int memberCount, vector<SweepTotals>& totals)
+{
+    for (size_t point = 0; point < grid.size(); ++point)
+    {
+        const MacroPolicy& policy = grid[point];
+        SweepTotals& pointTotals = totals[point];
+
+        for (int index = 0; index < memberCount; ++index)
+        {
+            const SweepMember& member = members[index];
+            int dailyProteinGrams, dailyCarbGrams, dailyFatGrams;
+            int proteinPerMeal, carbsPerMeal, fatsPerMeal;
+            int weeklyCalories, totalProteinGrams, totalCarbGrams, totalFatGrams;
+
+            calculateMacros(policy, member.dailyCalories, member.mealsPerDay,
+                dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
+                proteinPerMeal, carbsPerMeal, fatsPerMeal,
+                weeklyCalories,
+                totalProteinGrams, totalCarbGrams, totalFatGrams);
+
+            pointTotals.dailyProteinGrams += dailyProteinGrams;
+            pointTotals.dailyCarbGrams += dailyCarbGrams;
+            pointTotals.dailyFatGrams += dailyFatGrams;
+            pointTotals.proteinPerMeal += proteinPerMeal;
+            pointTotals.carbsPerMeal += carbsPerMeal;
+            pointTotals.fatsPerMeal += fatsPerMeal;
+
+            ++pointTotals.nutritionOutcomes[classifyNutrition(policy,
+                member.dailyCalories, member.weeklyWorkoutHours)];
+            ++pointTotals.mealFrequencyOutcomes[classifyMealFrequency(policy,
+                member.mealsPerDay * NUMBER_OF_DAYS, member.weeklyWorkoutHours)];
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --sweep batch mode. Evaluates every member under every
+//     grid point and writes one CSV line per grid point with the average
+//     macros and how many members get each piece of feedback.
+// Threads take blocks of members and keep their own totals, which are added
+//     together at the end, so the results do not depend on the thread count.
+// ---------------------------------------------------------------------------
+int runSweepMode(string membersFile, string gridFile, string outputFile)
+{
+    vector<MemberProfile> profiles;
+    vector<MacroPolicy> grid;
+    int threadCount = static_cast<int>(thread::hardware_concurrency());
+
+    if (!loadMemberProfiles(membersFile, profiles) || !loadSweepGrid(gridFile, grid))
+        return 1;
+
+    ofstream outFile(outputFile);
+
+    if (!outFile)
+    {
+        printErrorMessage("Unable to open " + outputFile);
+        return 1;
+    }
+
+    // Only the inputs the calculations use are kept
+    vector<SweepMember> members(profiles.size());
+
+    for (size_t index = 0; index < profiles.size(); ++index)
+    {
+        members[index].dailyCalories = profiles[index].dailyCalories;
+        members[index].mealsPerDay = profiles[index].mealsPerDay;
+        members[index].weeklyWorkoutHours = profiles[index].weeklyWorkoutHours;
+    }
+
+    profiles.clear();
+    profiles.shrink_to_fit();
+
+    if (threadCount < 1)
+        threadCount = 1;
+
+    SweepTotals emptyTotals = {};
+    vector<vector<SweepTotals>> threadTotals(threadCount,
+        vector<SweepTotals>(grid.size(), emptyTotals));
+    vector<thread> workers;
+    atomic<size_t> nextBlock(0);
+    size_t blockCount = (members.size() + SWEEP_MEMBER_BLOCK - 1) / SWEEP_MEMBER_BLOCK;
+
+    auto startTime = chrono::steady_clock::now();
+
+    for (int worker = 0; worker < threadCount; ++worker)
+    {
+        workers.push_back(thread([&, worker]()
+        {
+            size_t block;
+
+            while ((block = nextBlock.fetch_add(1)) < blockCount)
+            {
+                size_t first = block * SWEEP_MEMBER_BLOCK;
+                size_t count = members.size() - first;
+
+                if (count > static_cast<size_t>(SWEEP_MEMBER_BLOCK))
+                    count = SWEEP_MEMBER_BLOCK;
+
+                sweepMemberBlock(grid, members.data() + first,
+                    static_cast<int>(count), threadTotals[worker]);
+            }
+        }));
+    }
+
+    for (size_t worker = 0; worker < workers.size(); ++worker)
+        workers[worker].join();
+
+    // Add every thread's totals into the first thread's
+    vector<SweepTotals>& totals = threadTotals[0];
+
+    for (int worker = 1; worker < threadCount; ++worker)
+    {
+        for (size_t point = 0; point < grid.size(); ++point)
+        {
+            const SweepTotals& part = threadTotals[worker][point];
+
+            totals[point].dailyProteinGrams += part.dailyProteinGrams;
+            totals[point].dailyCarbGrams += part.dailyCarbGrams;
+            totals[point].dailyFatGrams += part.dailyFatGrams;
+            totals[point].proteinPerMeal += part.proteinPerMeal;
+            totals[point].carbsPerMeal += part.carbsPerMeal;
+            totals[point].fatsPerMeal += part.fatsPerMeal;
+
+            for (int outcome = 0; outcome < NUTRITION_OUTCOME_COUNT; ++outcome)
+                totals[point].nutritionOutcomes[outcome] += part.nutritionOutcomes[outcome];
+            for (int outcome = 0; outcome < MEAL_FREQUENCY_OUTCOME_COUNT; ++outcome)
+                totals[point].mealFrequencyOutcomes[outcome] += part.mealFrequencyOutcomes[outcome];
+        }
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+    double memberCount = (members.size() > 0) ? static_cast<double>(members.size()) : 1.0;
+
+    outFile << fixed << showpoint << setprecision(2);
+    outFile << "point,protein_basis_points,carb_basis_points,fat_basis_points,activity_high,activity_medium,"
+        << "cal_excess,cal_high,cal_medium,cal_low,"
+        << "avg_protein_grams,avg_carb_grams,avg_fat_grams,"
+        << "avg_protein_per_meal,avg_carbs_per_meal,avg_fats_per_meal,"
+        << "sufficient,decent,under_fueling,excess,balanced,"
+        << "meals_excellent,meals_too_few,meals_too_many,meals_appropriate\n";
+
+    for (size_t point = 0; point < grid.size(); ++point)
+    {
+        const MacroPolicy& policy = grid[point];
+        const SweepTotals& pointTotals = totals[point];
+
+        outFile << (point + 1) << ',' << policy.proteinBasisPoints << ','
+            << policy.carbBasisPoints << ',' << policy.fatBasisPoints << ','
+            << policy.activityHigh << ',' << policy.activityMedium << ','
+            << policy.calExcess << ',' << policy.calHigh << ','
+            << policy.calMedium << ',' << policy.calLow << ','
+            << pointTotals.dailyProteinGrams / memberCount << ','
+            << pointTotals.dailyCarbGrams / memberCount << ','
+            << pointTotals.dailyFatGrams / memberCount << ','
+            << pointTotals.proteinPerMeal / memberCount << ','
+            << pointTotals.carbsPerMeal / memberCount << ','
+            << pointTotals.fatsPerMeal / memberCount;
+
+        for (int outcome = 0; outcome < NUTRITION_OUTCOME_COUNT; ++outcome)
+            outFile << ',' << pointTotals.nutritionOutcomes[outcome];
+        for (int outcome = 0; outcome < MEAL_FREQUENCY_OUTCOME_COUNT; ++outcome)
+            outFile << ',' << pointTotals.mealFrequencyOutcomes[outcome];
+
+        outFile << "\n";
+    }
+
+    outFile.close();
+
+    double evaluations = static_cast<double>(members.size()) * grid.size();
+
+    printSummaryLabel("Members evaluated: ") << members.size() << "\n";
+    printSummaryLabel("Grid points: ") << grid.size() << "\n";
+    printElapsedSummary(elapsed.count(), evaluations, "Evaluations");
+
+    return outFile.fail() ? 1 : 0;
+}
+
+
+// ====================== MEMORY-MAPPED SNAPSHOT DEFINITIONS ==================
+
+// ---------------------------------------------------------------------------
+// Function that appends text to a snapshot string pool and returns where it
+//     was put.
+// ---------------------------------------------------------------------------
+SnapshotString addSnapshotString(string& strings, const string& text)
+{
+    SnapshotString stored = {};
+
+    stored.offset = strings.length();
+    stored.length = static_cast<uint32_t>(text.length());
+    strings += text;
+
+    return stored;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that makes sure length bytes of a snapshot, starting at offset,
+//     are mapped and returns where they start.
+// Only one window of at least SNAPSHOT_VIEW_BYTES is mapped at a time,
+//     starting on a SNAPSHOT_VIEW_ALIGNMENT boundary, so a snapshot does not
+//     need to fit in a 32-bit address space. The pointer is only valid until
+//     the next call, so callers copy what they need.
+// Returns nullptr if the range is empty, not inside the file, or cannot be
+//     mapped.
+// ---------------------------------------------------------------------------
+const char* mapSnapshotRange(MappedSnapshot& snapshot, uint64_t offset,
+    uint64_t length)
+{
+    if (length == 0 || offset > snapshot.fileBytes || length > snapshot.fileBytes - offset)
+        return nullptr;
+
+    if (snapshot.view != nullptr && offset >= snapshot.viewOffset &&
+        offset + length <= snapshot.viewOffset + snapshot.viewBytes)
+        return snapshot.view + (offset - snapshot.viewOffset);
+
+    if (snapshot.view != nullptr)
+        UnmapViewOfFile(snapshot.view);
+
+    uint64_t viewOffset = offset - offset % SNAPSHOT_VIEW_ALIGNMENT;
+    uint64_t viewBytes = offset + length - viewOffset;
+
+    if (viewBytes < SNAPSHOT_VIEW_BYTES)
+        viewBytes = SNAPSHOT_VIEW_BYTES;
+    if (viewBytes > snapshot.fileBytes - viewOffset)
+        viewBytes = snapshot.fileBytes - viewOffset;
+
+    snapshot.view = nullptr;
+
+    // A single range too large for this build's address space cannot be mapped
+    if (viewBytes == static_cast<SIZE_T>(viewBytes))
+    {
+        snapshot.view = static_cast<const char*>(MapViewOfFile(snapshot.mapping, FILE_MAP_READ,
+            static_cast<DWORD>(viewOffset >> 32), static_cast<DWORD>(viewOffset & 0xFFFFFFFFULL),
+            static_cast<SIZE_T>(viewBytes)));
+    }
+
+    if (snapshot.view == nullptr)
+        return nullptr;
+
+    snapshot.viewOffset = viewOffset;
+    snapshot.viewBytes = viewBytes;
+
+    return snapshot.view + (offset - viewOffset);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that copies text out of a snapshot's string pool.
+// Returns an empty string if the text is not inside the pool.
+// ---------------------------------------------------------------------------
+string getSnapshotString(MappedSnapshot& snapshot, const SnapshotString& text)
+{
+    if (text.length == 0 || text.offset > snapshot.header.stringBytes ||
+        text.length > snapshot.header.stringBytes - text.offset)
+        return "";
+
+    const char* start = mapSnapshotRange(snapshot, snapshot.header.stringsOffset + text.offset, text.length);
+
+    return (start != nullptr) ? string(start, text.length) : "";
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that writes a snapshot of every member, their macro plan and
+//     weekly stats, and a copy of the packed report file.
+// Queries read reports from this copy, so later report rewrites never
+//     change what a snapshot shows. The report is copied one member at a time
+//     after the other parts, and then the header and records (which hold the
+//     report hashes) are written again at the start.
+// The snapshot is written to a temporary file and then moved over the old
+//     one, so a reader sees either the old snapshot or the complete new one.
+// ---------------------------------------------------------------------------
+bool writeSnapshot(string fileName, const vector<MemberProfile>& members,
+    const vector<ReportValues>& reports,
+    const vector<ReportSectionIndex>& reportIndex, string reportFileName)
+{
+    SnapshotHeader header = {};
+    vector<SnapshotMember> records(members.size());
+    string strings;
+    uint64_t slots = 2;
+
+    // Keep the lookup table at most half full
+    while (slots < 2 * static_cast<uint64_t>(members.size()))
+        slots *= 2;
+
+    vector<uint32_t> lookup(static_cast<size_t>(slots), 0);
+
+    for (size_t index = 0; index < members.size(); ++index)
+    {
+        const MemberProfile& member = members[index];
+        const ReportValues& values = reports[index];
+        const ReportSectionIndex* sections = &reportIndex[index * REPORT_SECTION_COUNT];
+        SnapshotMember& record = records[index];
+        WeeklyCalorieStats stats;
+
+        record.name = addSnapshotString(strings, member.name);
+        record.favoriteProtein = addSnapshotString(strings, member.favoriteProtein);
+        record.weeklyWorkoutHours = member.weeklyWorkoutHours;
+        record.dailyCalories = member.dailyCalories;
+        record.mealsPerDay = member.mealsPerDay;
+        record.goal = member.goal;
+
+        for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+            record.dailyCaloriesLog[day] = member.dailyCaloriesLog[day];
+
+        record.weeklyCalories = values.weeklyCalories;
+        record.dailyProteinGrams = values.dailyProteinGrams;
+        record.dailyCarbGrams = values.dailyCarbGrams;
+        record.dailyFatGrams = values.dailyFatGrams;
+        record.totalProteinGrams = values.totalProteinGrams;
+        record.totalCarbGrams = values.totalCarbGrams;
+        record.totalFatGrams = values.totalFatGrams;
+        record.proteinPerMeal = values.proteinPerMeal;
+        record.carbsPerMeal = values.carbsPerMeal;
+        record.fatsPerMeal = values.fatsPerMeal;
+
+        initWeeklyCalorieStats(member, stats);
+        record.totalCalories = stats.totalCalories;
+        record.highestCalories = stats.highestCalories;
+        record.entryCount = stats.entryCount;
+
+        // A member's report sections are next to each other in the file
+        record.reportOffset = sections[0].offset;
+        record.reportLength = sections[REPORT_SECTION_COUNT - 1].offset +
+            sections[REPORT_SECTION_COUNT - 1].length - sections[0].offset;
+
+        // Linear probing; when names repeat, the first member is found
+        size_t slot = static_cast<size_t>(hashFingerprint(member.name) & (slots - 1));
+
+        while (lookup[slot] != 0 && members[lookup[slot] - 1].name != member.name)
+            slot = (slot + 1) & static_cast<size_t>(slots - 1);
+
+        if (lookup[slot] == 0)
+            lookup[slot] = static_cast<uint32_t>(index + 1);
+    }
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.memberCount = records.size();
+    header.membersOffset = sizeof(SnapshotHeader);
+    header.lookupOffset = header.membersOffset + records.size() * sizeof(SnapshotMember);
+    header.lookupSlots = slots;
+    header.stringsOffset = header.lookupOffset + slots * sizeof(uint32_t);
+    header.stringBytes = strings.length();
+    header.reportsOffset = header.stringsOffset + header.stringBytes;
+
+    if (reportIndex.size() > 0)
+        header.reportBytes = reportIndex.back().offset + reportIndex.back().length;
+
+    header.fileBytes = header.reportsOffset + header.reportBytes;
+
+    string tempFileName = fileName + TEMP_FILE_EXTENSION;
+    ifstream reportFile(reportFileName, ios::binary);
+    ofstream outFile(tempFileName, ios::binary | ios::trunc);
+    string report;
+    bool copied = static_cast<bool>(reportFile);
+
+    if (!outFile)
+        return false;
+
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(records.data()),
+        static_cast<streamsize>(records.size() * sizeof(SnapshotMember)));
+    outFile.write(reinterpret_cast<const char*>(lookup.data()),
+        static_cast<streamsize>(lookup.size() * sizeof(uint32_t)));
+    outFile.write(strings.data(), static_cast<streamsize>(strings.length()));
+
+    // Reports are stored in member order and cover the whole file, so this
+    // copies the report file once, front to back
+    for (size_t index = 0; index < records.size() && copied; ++index)
+    {
+        SnapshotMember& record = records[index];
+
+        report.resize(static_cast<size_t>(record.reportLength));
+        copied = record.reportLength == 0 || reportFile.read(&report[0], record.reportLength);
+
+        record.reportHash = hashFingerprint(report);
+        outFile.write(report.data(), static_cast<streamsize>(report.length()));
+    }
+
+    copied = copied && static_cast<uint64_t>(outFile.tellp()) == header.fileBytes;
+
+    outFile.seekp(0);
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(records.data()),
+        static_cast<streamsize>(records.size() * sizeof(SnapshotMember)));
+    outFile.close();
+
+    // Readers keep the old snapshot mapped until they reopen it
+    if (!copied || outFile.fail() || !MoveFileExA(tempFileName.c_str(), fileName.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that opens a snapshot file for mapping and checks its layout.
+// Only the header is read up front; the rest is mapped as it is used.
+// Returns false if the file cannot be mapped or is not a complete snapshot.
+// ---------------------------------------------------------------------------
+bool openSnapshot(string fileName, MappedSnapshot& snapshot)
+{
+    LARGE_INTEGER fileSize;
+
+    snapshot.mapping = NULL;
+    snapshot.view = nullptr;
+    snapshot.viewOffset = 0;
+    snapshot.viewBytes = 0;
+
+    // Sharing delete access lets a writer replace the file while it is mapped
+    snapshot.file = CreateFileA(fileName.c_str(), GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (snapshot.file == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!GetFileSizeEx(snapshot.file, &fileSize) ||
+        fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SnapshotHeader)))
+    {
+        closeSnapshot(snapshot);
+        return false;
+    }
+
+    snapshot.fileBytes = static_cast<uint64_t>(fileSize.QuadPart);
+    snapshot.mapping = CreateFileMappingA(snapshot.file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    const char* start = (snapshot.mapping != NULL) ?
+        mapSnapshotRange(snapshot, 0, sizeof(SnapshotHeader)) : nullptr;
+
+    if (start == nullptr)
+    {
+        closeSnapshot(snapshot);
+        return false;
+    }
+
+    memcpy(&snapshot.header, start, sizeof(SnapshotHeader));
+
+    const SnapshotHeader& header = snapshot.header;
+    uint64_t size = snapshot.fileBytes;
+
+    // Every part must lie inside the file, in the order the writer puts them
+    bool valid = memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+        header.fileBytes == size &&
+        header.membersOffset == sizeof(SnapshotHeader) &&
+        header.memberCount <= (size - header.membersOffset) / sizeof(SnapshotMember) &&
+        header.lookupOffset == header.membersOffset + header.memberCount * sizeof(SnapshotMember) &&
+        header.lookupSlots > 0 && (header.lookupSlots & (header.lookupSlots - 1)) == 0 &&
+        header.lookupSlots <= (size - header.lookupOffset) / sizeof(uint32_t) &&
+        header.stringsOffset == header.lookupOffset + header.lookupSlots * sizeof(uint32_t) &&
+        header.stringBytes <= size - header.stringsOffset &&
+        header.reportsOffset == header.stringsOffset + header.stringBytes &&
+        header.reportBytes == size - header.reportsOffset;
+
+    if (!valid)
+    {
+        closeSnapshot(snapshot);
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that unmaps a snapshot and closes its handles.
+// ---------------------------------------------------------------------------
+void closeSnapshot(MappedSnapshot& snapshot)
+{
+    if (snapshot.view != nullptr)
+        UnmapViewOfFile(snapshot.view);
+    if (snapshot.mapping != NULL)
+        CloseHandle(snapshot.mapping);
+    if (snapshot.file != INVALID_HANDLE_VALUE)
+        CloseHandle(snapshot.file);
+
+    snapshot.view = nullptr;
+    snapshot.mapping = NULL;
+    snapshot.file = INVALID_HANDLE_VALUE;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that finds a member in a snapshot by name and copies their
+//     record into member.
+// Returns false if no member has that name, or if the member's report
+//     location is outside the report copy in the snapshot.
+// ---------------------------------------------------------------------------
+bool findSnapshotMember(MappedSnapshot& snapshot, const string& name,
+    SnapshotMember& member)
+{
+    const SnapshotHeader& header = snapshot.header;
+    uint64_t mask = header.lookupSlots - 1;
+    uint64_t slot = hashFingerprint(name) & mask;
+
+    // The table is never full, but stop after one pass in case it is damaged
+    for (uint64_t probe = 0; probe <= mask; ++probe)
+    {
+        const char* slotBytes = mapSnapshotRange(snapshot, header.lookupOffset + slot * sizeof(uint32_t),
+            sizeof(uint32_t));
+        uint32_t entry = 0;
+
+        if (slotBytes == nullptr)
+            return false;
+
+        memcpy(&entry, slotBytes, sizeof(entry));
+
+        if (entry == 0 || entry > header.memberCount)
+            return false;
+
+        const char* record = mapSnapshotRange(snapshot,
+            header.membersOffset + (entry - 1) * sizeof(SnapshotMember), sizeof(SnapshotMember));
+
+        if (record == nullptr)
+            return false;
+
+        memcpy(&member, record, sizeof(SnapshotMember));
+
+        if (member.name.length == name.length() &&
+            getSnapshotString(snapshot, member.name) == name)
+        {
+            return member.reportOffset >= 0 && member.reportLength >= 0 &&
+                static_cast<uint64_t>(member.reportOffset) <= header.reportBytes &&
+                static_cast<uint64_t>(member.reportLength) <= header.reportBytes - member.reportOffset;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return false;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --snapshot-write batch mode. Brings the packed report
+//     file up to date (only changed sections are rewritten) and then writes
+//     a snapshot of every member with a copy of their report.
+// ---------------------------------------------------------------------------
+int runSnapshotWriteMode(string membersFile, string reportFile,
+    string snapshotFile)
+{
+    vector<MemberProfile> members;
+    vector<ReportSectionIndex> reportIndex;
+    RenderCache renderCache;
+    long long sectionsRewritten = 0;
+
+    if (!loadMemberProfiles(membersFile, members))
+        return 1;
+
+    auto startTime = chrono::steady_clock::now();
+
+    initRenderCache(renderCache, RENDER_CACHE_BYTE_LIMIT);
+    vector<ReportValues> reports(members.size());
+
+    for (size_t index = 0; index < members.size(); ++index)
+        buildReportValues(members[index], reports[index]);
+
+    if (!writeReportSections(renderCache, reportFile, reports, sectionsRewritten) ||
+        !loadReportIndex(reportFile + REPORT_INDEX_EXTENSION, reportIndex) ||
+        reportIndex.size() != members.size() * REPORT_SECTION_COUNT)
+    {
+        printErrorMessage("Unable to write " + reportFile);
+        return 1;
+    }
+
+    if (!writeSnapshot(snapshotFile, members, reports, reportIndex, reportFile))
+    {
+        printErrorMessage("Unable to write " + snapshotFile);
+        return 1;
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    printSummaryLabel("Members in snapshot: ") << members.size() << "\n";
+    printSummaryLabel("Report sections rewritten: ") << sectionsRewritten << "\n";
+    printElapsedSummary(elapsed.count(), static_cast<double>(members.size()), "Members");
+
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --snapshot-query batch mode. Maps the snapshot and shows
+//     each named member's plan and stats, followed by the copy of their
+//     report kept in the snapshot.
+// ---------------------------------------------------------------------------
+int runSnapshotQueryMode(string snapshotFile, int nameCount, char* names[])
+{
+    MappedSnapshot snapshot;
+    const char* goalNames[] = {"Fat loss", "Maintenance", "Muscle gain"};
+    int missingCount = 0;
+
+    auto startTime = chrono::steady_clock::now();
+
+    if (!openSnapshot(snapshotFile, snapshot))
+    {
+        printErrorMessage(snapshotFile + " is missing or is not a valid snapshot");
+        return 1;
+    }
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - startTime;
+
+    cout << fixed << showpoint << setprecision(3);
+    printSummaryLabel("Members in snapshot: ") << snapshot.header.memberCount << "\n";
+    printSummaryLabel("Snapshot opened in: ") << elapsed.count() << " ms\n";
+    cout << setprecision(2);
+
+    for (int index = 0; index < nameCount; ++index)
+    {
+        SnapshotMember member;
+
+        if (!findSnapshotMember(snapshot, names[index], member))
+        {
+            printErrorMessage("No valid record for a member named " + string(names[index]) + " in " + snapshotFile);
+            ++missingCount;
+            continue;
+        }
+
+        setConsoleColor(COLOR_SUB_HEADING);
+        printSectionBreakLine();
+        cout << "Member: " << names[index] << "\n\n";
+        setConsoleColor(COLOR_DEFAULT);
+
+        printSummaryLabel("Favorite protein source: ") << getSnapshotString(snapshot, member.favoriteProtein) << "\n";
+        printSummaryLabel("Daily calorie target: ") << member.dailyCalories << "\n";
+        printSummaryLabel("Meals per day: ") << member.mealsPerDay << "\n";
+        printSummaryLabel("Weekly workout hours: ") << member.weeklyWorkoutHours << "\n";
+
+        if (member.goal >= FAT_LOSS && member.goal <= MUSCLE_GAIN)
+            printSummaryLabel("Goal: ") << goalNames[member.goal] << "\n";
+
+        printSummaryLabel("Daily protein: ") << member.dailyProteinGrams << " grams\n";
+        printSummaryLabel("Daily carbs: ") << member.dailyCarbGrams << " grams\n";
+        printSummaryLabel("Daily fats: ") << member.dailyFatGrams << " grams\n";
+        printSummaryLabel("Logged calories this week: ") << member.totalCalories << "\n";
+        printSummaryLabel("Highest daily calories this week: ") << member.highestCalories << "\n\n";
+
+        // The copy cannot be rewritten under us; the hash only catches damage
+        const char* start = mapSnapshotRange(snapshot, snapshot.header.reportsOffset + member.reportOffset,
+            static_cast<uint64_t>(member.reportLength));
+        string report = (start != nullptr) ? string(start, static_cast<size_t>(member.reportLength)) : "";
+
+        if (start != nullptr && hashFingerprint(report) == member.reportHash)
+        {
+            // The console stream adds its own carriage returns
+            report.erase(remove(report.begin(), report.end(), '\r'), report.end());
+            cout << report;
+        }
+        else
+        {
+            cout << "The report stored in " << snapshotFile << " is damaged; "
+                << "run --snapshot-write again to see the report.\n\n";
+        }
+    }
+
+    closeSnapshot(snapshot);
+
+    return (missingCount > 0) ? 1 : 0;
+}
+
+
+// ======================= SHARDED BATCH RUN DEFINITIONS =====================
+
+// ---------------------------------------------------------------------------
+// Function that returns the name of one of a shard's files, which sit next
+//     to the final output file.
+// ---------------------------------------------------------------------------
+string getShardFileName(string outputFile, int shard, string extension)
+{
+    return outputFile + ".shard" + to_string(shard) + extension;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that lists every total in stats, in the order they are saved.
+// ---------------------------------------------------------------------------
+void getCohortStatsFields(CohortStats& stats, vector<long long*>& fields)
+{
+    fields.clear();
+    fields.push_back(&stats.memberCount);
+
+    for (int goal = FAT_LOSS; goal <= MUSCLE_GAIN; ++goal)
+        fields.push_back(&stats.goalCounts[goal]);
+
+    fields.push_back(&stats.dailyCalories);
+    fields.push_back(&stats.dailyProteinGrams);
+    fields.push_back(&stats.dailyCarbGrams);
+    fields.push_back(&stats.dailyFatGrams);
+
+    for (int outcome = 0; outcome < NUTRITION_OUTCOME_COUNT; ++outcome)
+        fields.push_back(&stats.nutritionOutcomes[outcome]);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that adds one shard's totals into the combined totals.
+// ---------------------------------------------------------------------------
+void addCohortStats(CohortStats& total, CohortStats part)
+{
+    vector<long long*> totalFields;
+    vector<long long*> partFields;
+
+    getCohortStatsFields(total, totalFields);
+    getCohortStatsFields(part, partFields);
+
+    for (size_t index = 0; index < totalFields.size(); ++index)
+        *totalFields[index] += *partFields[index];
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that marks a shard as finished by saving the hash of its input,
+//     the shard count, and its totals. Written through a temporary file, so
+//     the checkpoint either exists in full or not at all.
+// ---------------------------------------------------------------------------
+bool saveShardCheckpoint(string fileName, unsigned long long inputHash,
+    int shardCount, CohortStats stats)
+{
+    string tempFileName = fileName + TEMP_FILE_EXTENSION;
+    ofstream outFile(tempFileName, ios::trunc);
+    vector<long long*> fields;
+
+    if (!outFile)
+        return false;
+
+    getCohortStatsFields(stats, fields);
+    outFile << inputHash << PROFILE_FIELD_DELIMITER << shardCount;
+
+    for (size_t index = 0; index < fields.size(); ++index)
+        outFile << PROFILE_FIELD_DELIMITER << *fields[index];
+
+    outFile << "\n";
+    outFile.close();
+
+    if (outFile.fail() ||
+        !MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads a shard's checkpoint.
+// Returns false if the shard has no checkpoint or it cannot be read.
+// ---------------------------------------------------------------------------
+bool loadShardCheckpoint(string fileName, unsigned long long& inputHash,
+    int& shardCount, CohortStats& stats)
+{
+    ifstream inFile(fileName);
+    string line;
+    string field;
+    vector<long long*> fields;
+
+    if (!inFile || !getline(inFile, line))
+        return false;
+
+    istringstream values(line);
+    getCohortStatsFields(stats, fields);
+
+    if (!getline(values, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> inputHash))
+        return false;
+    if (!getline(values, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> shardCount))
+        return false;
+
+    for (size_t index = 0; index < fields.size(); ++index)
+    {
+        if (!getline(values, field, PROFILE_FIELD_DELIMITER) ||
+            !(istringstream(field) >> *fields[index]))
+            return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks whether a shard has a checkpoint for exactly this
+//     input and shard count, and loads its totals if so.
+// ---------------------------------------------------------------------------
+bool isShardCheckpointCurrent(string outputFile, int shard,
+    unsigned long long inputHash, int shardCount, CohortStats& stats)
+{
+    unsigned long long checkpointHash = 0;
+    int checkpointShardCount = 0;
+
+    return loadShardCheckpoint(getShardFileName(outputFile, shard,
+        SHARD_OUTPUT_EXTENSION) + SHARD_CHECKPOINT_EXTENSION,
+        checkpointHash, checkpointShardCount, stats) &&
+        checkpointHash == inputHash && checkpointShardCount == shardCount;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that returns the first field of a CSV line written by the export
+//     layer, with any quoting removed.
+// ---------------------------------------------------------------------------
+string readCsvFirstField(const string& line)
+{
+    string field;
+
+    if (line.length() == 0 || line[0] != '"')
+        return line.substr(0, line.find(','));
+
+    for (size_t index = 1; index < line.length(); ++index)
+    {
+        if (line[index] != '"')
+            field += line[index];
+        else if (index + 1 < line.length() && line[index + 1] == '"')
+            field += line[++index];
+        else
+            break;
+    }
+
+    return field;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads one CSV record written by the export layer. A quoted
+//     field may hold line breaks, so lines are joined until every quote is
+//     closed. The record's final line break is not kept.
+// Returns false at the end of the input.
+// ---------------------------------------------------------------------------
+bool readCsvRecord(istream& in, string& record)
+{
+    string line;
+    bool quoted = false;
+
+    if (!getline(in, record))
+        return false;
+
+    for (size_t index = 0; index < record.length(); ++index)
+    {
+        if (record[index] == '"')
+            quoted = !quoted;
+    }
+
+    // An escaped quote ("") flips twice, so only an open field carries on
+    while (quoted && getline(in, line))
+    {
+        record += '\n';
+
+        for (size_t index = 0; index < line.length(); ++index)
+        {
+            if (line[index] == '"')
+                quoted = !quoted;
+        }
+
+        record += line;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that splits the members file into one input file per shard. A
+//     member's shard comes from the hash of their name, so a member always
+//     lands in the same shard. Lines are copied unchanged; the workers
+//     validate them.
+// inputHashes is set to the hash of each shard's input file.
+// ---------------------------------------------------------------------------
+bool partitionMembers(string membersFile, string outputFile, int shardCount,
+    vector<unsigned long long>& inputHashes)
+{
+    ifstream inFile(membersFile);
+    vector<unique_ptr<ofstream>> shardFiles(shardCount);
+    string line;
+
+    if (!inFile)
+    {
+        printErrorMessage("Unable to open " + membersFile);
+        return false;
+    }
+
+    inputHashes.assign(shardCount, hashFingerprint(""));
+
+    for (int shard = 0; shard < shardCount; ++shard)
+    {
+        string shardFileName = getShardFileName(outputFile, shard, SHARD_INPUT_EXTENSION);
+        shardFiles[shard].reset(new ofstream(shardFileName, ios::binary | ios::trunc));
+
+        if (!*shardFiles[shard])
+        {
+            printErrorMessage("Unable to open " + shardFileName);
+            return false;
+        }
+    }
+
+    while (getline(inFile, line))
+    {
+        if (line.length() > 0 && line[line.length() - 1] == '\r')
+            line.erase(line.length() - 1);
+
+        if (line.length() == 0)
+            continue;
+
+        string name = line.substr(0, line.find(PROFILE_FIELD_DELIMITER));
+        int shard = static_cast<int>(hashFingerprint(name) % shardCount);
+
+        line += '\n';
+        *shardFiles[shard] << line;
+        inputHashes[shard] = extendFingerprintHash(inputHashes[shard], line);
+    }
+
+    for (int shard = 0; shard < shardCount; ++shard)
+    {
+        shardFiles[shard]->close();
+
+        if (shardFiles[shard]->fail())
+        {
+            printErrorMessage("Unable to write " + getShardFileName(outputFile, shard, SHARD_INPUT_EXTENSION));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that starts a worker process for one shard.
+// Returns false if the process could not be started.
+// ---------------------------------------------------------------------------
+bool launchShardWorker(string programPath, string inputFile,
+    string outputFile, int shardCount, HANDLE& process)
+{
+    STARTUPINFOA startupInfo = {};
+    PROCESS_INFORMATION processInfo = {};
+    string commandLine = "\"" + programPath + "\" --shard-worker \"" +
+        inputFile + "\" \"" + outputFile + "\" " + to_string(shardCount);
+
+    startupInfo.cb = sizeof(startupInfo);
+
+    // CreateProcessA may change the command line, so give it a copy
+    vector<char> command(commandLine.begin(), commandLine.end());
+    command.push_back('\0');
+
+    if (!CreateProcessA(NULL, command.data(), NULL, NULL, FALSE, 0, NULL, NULL,
+        &startupInfo, &processInfo))
+        return false;
+
+    CloseHandle(processInfo.hThread);
+    process = processInfo.hProcess;
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that merges the sorted shard outputs into one CSV file ordered by
+//     member name (ties keep shard order). Only the first record of each
+//     shard is held in memory at a time.
+// ---------------------------------------------------------------------------
+bool mergeShardOutputs(string outputFile, int shardCount)
+{
+    vector<unique_ptr<ifstream>> shardFiles(shardCount);
+    vector<string> records(shardCount);
+    vector<pair<string, int>> heads;    // Heap of (name, shard), smallest name on top
+    auto comesAfter = [](const pair<string, int>& first, const pair<string, int>& second)
+    {
+        return first > second;
+    };
+
+    for (int shard = 0; shard < shardCount; ++shard)
+    {
+        shardFiles[shard].reset(new ifstream(getShardFileName(outputFile, shard,
+            SHARD_OUTPUT_EXTENSION), ios::binary));
+
+        if (!*shardFiles[shard])
+            return false;
+
+        if (readCsvRecord(*shardFiles[shard], records[shard]))
+            heads.push_back(make_pair(readCsvFirstField(records[shard]), shard));
+    }
+
+    make_heap(heads.begin(), heads.end(), comesAfter);
+
+    string tempFileName = outputFile + TEMP_FILE_EXTENSION;
+    ofstream outFile(tempFileName, ios::binary | ios::trunc);
+
+    if (!outFile)
+        return false;
+
+    // The buffer is large, so keep the writer off the stack
+    unique_ptr<ExportWriter> writer(new ExportWriter);
+    writer->used = 0;
+    writer->out = &outFile;
+
+    writeExportHeader(*writer, EXPORT_CSV);
+
+    while (!heads.empty())
+    {
+        pop_heap(heads.begin(), heads.end(), comesAfter);
+        int shard = heads.back().second;
+        heads.pop_back();
+
+        writeExportBytes(*writer, records[shard].data(), static_cast<int>(records[shard].length()));
+        writeExportBytes(*writer, "\n", 1);
+
+        if (readCsvRecord(*shardFiles[shard], records[shard]))
+        {
+            heads.push_back(make_pair(readCsvFirstField(records[shard]), shard));
+            push_heap(heads.begin(), heads.end(), comesAfter);
+        }
+    }
+
+    flushExportWriter(*writer);
+    outFile.close();
+
+    if (outFile.fail() ||
+        !MoveFileExA(tempFileName.c_str(), outputFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --shard-worker mode started by --shard. Computes every
+//     member in one shard's input file, writes their CSV export records
+//     sorted by name, and then saves the shard's checkpoint.
+// Returns SHARD_EXIT_INVALID_INPUT if a member line is invalid (running
+//     again cannot help) and 1 for any other failure, such as an input file
+//     that cannot be opened or read, so the shard is retried.
+// ---------------------------------------------------------------------------
+int runShardWorkerMode(string inputFile, string outputFile, int shardCount)
+{
+    MemberProfileReader reader;
+    MemberProfile member;
+    vector<MemberProfile> members;
+    CohortStats stats = {};
+    ReportValues values;
+
+    if (!openMemberProfiles(inputFile, reader))
+        return 1;
+
+    while (readMemberProfile(reader, member))
+        members.push_back(member);
+
+    if (reader.invalidLine)
+        return SHARD_EXIT_INVALID_INPUT;
+    if (reader.readFailed)
+        return 1;
+
+    // The checkpoint records exactly which input these results came from.
+    // The reader hashed every line as it parsed it, the same way
+    // partitionMembers hashed the lines it wrote.
+    unsigned long long inputHash = reader.inputHash;
+
+    // Sorted output lets the shards be merged in a single pass
+    vector<size_t> order(members.size());
+
+    for (size_t index = 0; index < members.size(); ++index)
+        order[index] = index;
+
+    stable_sort(order.begin(), order.end(), [&members](size_t first, size_t second)
+    {
+        return members[first].name < members[second].name;
+    });
+
+    string tempFileName = outputFile + TEMP_FILE_EXTENSION;
+    ofstream outFile(tempFileName, ios::binary | ios::trunc);
+
+    if (!outFile)
+    {
+        printErrorMessage("Unable to open " + tempFileName);
+        return 1;
+    }
+
+    unique_ptr<ExportWriter> writer(new ExportWriter);
+    writer->used = 0;
+    writer->out = &outFile;
+
+    for (size_t index = 0; index < order.size(); ++index)
+    {
+        const MemberProfile& sortedMember = members[order[index]];
+
+        buildReportValues(sortedMember, values);
+        writeExportRecord(*writer, EXPORT_CSV, values);
+
+        stats.memberCount++;
+        stats.goalCounts[sortedMember.goal]++;
+        stats.dailyCalories += values.dailyCalories;
+        stats.dailyProteinGrams += values.dailyProteinGrams;
+        stats.dailyCarbGrams += values.dailyCarbGrams;
+        stats.dailyFatGrams += values.dailyFatGrams;
+        stats.nutritionOutcomes[classifyNutrition(DEFAULT_MACRO_POLICY,
+            sortedMember.dailyCalories, sortedMember.weeklyWorkoutHours)]++;
+    }
+
+    flushExportWriter(*writer);
+    outFile.close();
+
+    // The checkpoint is saved last, so it only exists once the output is complete
+    if (outFile.fail() ||
+        !MoveFileExA(tempFileName.c_str(), outputFile.c_str(), MOVEFILE_REPLACE_EXISTING) ||
+        !saveShardCheckpoint(outputFile + SHARD_CHECKPOINT_EXTENSION, inputHash, shardCount, stats))
+    {
+        remove(tempFileName.c_str());
+        printErrorMessage("Unable to write " + outputFile);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --shard batch mode. Splits the members by name hash into
+//     shardCount shards, runs one worker process per shard, and merges their
+//     outputs into one CSV ordered by name plus a file of cohort totals.
+// A shard whose checkpoint matches its input is not run again, so a failed
+//     run can simply be repeated. Shards that fail are retried up to
+//     SHARD_ATTEMPT_LIMIT times, except when the worker reports invalid
+//     members, which would fail the same way every time.
+// ---------------------------------------------------------------------------
+int runShardMode(string membersFile, string outputFile, int shardCount)
+{
+    char programPath[MAX_PATH];
+    vector<unsigned long long> inputHashes;
+    CohortStats totals = {};
+    int resumedCount = 0;
+    int launchCount = 0;
+    int invalidCount = 0;
+
+    if (shardCount < 1 || shardCount > SHARD_COUNT_LIMIT)
+    {
+        printErrorMessage("Shard count must be from 1 to " + to_string(SHARD_COUNT_LIMIT));
+        return 1;
+    }
+
+    // Workers run this same program
+    if (GetModuleFileNameA(NULL, programPath, MAX_PATH) == 0)
+    {
+        printErrorMessage("Unable to find the program path for the workers");
+        return 1;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+
+    if (!partitionMembers(membersFile, outputFile, shardCount, inputHashes))
+        return 1;
+
+    vector<CohortStats> shardStats(shardCount);
+    vector<bool> finished(shardCount, false);
+    vector<bool> invalidInput(shardCount, false);
+
+    for (int shard = 0; shard < shardCount; ++shard)
+    {
+        if (isShardCheckpointCurrent(outputFile, shard, inputHashes[shard],
+            shardCount, shardStats[shard]))
+        {
+            finished[shard] = true;
+            ++resumedCount;
+        }
+    }
+
+    int unfinishedCount = shardCount - resumedCount;
+
+    for (int attempt = 0; attempt < SHARD_ATTEMPT_LIMIT && unfinishedCount > invalidCount; ++attempt)
+    {
+        vector<HANDLE> processes(shardCount, NULL);
+
+        // Start every unfinished shard, then wait for all of them
+        for (int shard = 0; shard < shardCount; ++shard)
+        {
+            if (!finished[shard] && !invalidInput[shard] && launchShardWorker(programPath,
+                getShardFileName(outputFile, shard, SHARD_INPUT_EXTENSION),
+                getShardFileName(outputFile, shard, SHARD_OUTPUT_EXTENSION),
+                shardCount, processes[shard]))
+                ++launchCount;
+        }
+
+        for (int shard = 0; shard < shardCount; ++shard)
+        {
+            DWORD exitCode = 1;
+
+            if (processes[shard] == NULL)
+                continue;
+
+            WaitForSingleObject(processes[shard], INFINITE);
+            GetExitCodeProcess(processes[shard], &exitCode);
+            CloseHandle(processes[shard]);
+
+            if (exitCode == 0 && isShardCheckpointCurrent(outputFile, shard,
+                inputHashes[shard], shardCount, shardStats[shard]))
+            {
+                finished[shard] = true;
+                --unfinishedCount;
+            }
+            else if (exitCode == static_cast<DWORD>(SHARD_EXIT_INVALID_INPUT))
+            {
+                invalidInput[shard] = true;
+                ++invalidCount;
+            }
+        }
+    }
+
+    if (unfinishedCount > 0)
+    {
+        if (invalidCount > 0)
+            printErrorMessage(to_string(invalidCount) + " shard(s) have invalid members; fix " +
+                membersFile + " and run again");
+        if (unfinishedCount > invalidCount)
+            printErrorMessage(to_string(unfinishedCount - invalidCount) + " shard(s) failed after " +
+                to_string(SHARD_ATTEMPT_LIMIT) + " attempts; run again to retry them");
+
+        return 1;
+    }
+
+    if (!mergeShardOutputs(outputFile, shardCount))
+    {
+        printErrorMessage("Unable to write " + outputFile);
+        return 1;
+    }
+
+    for (int shard = 0; shard < shardCount; ++shard)
+        addCohortStats(totals, shardStats[shard]);
+
+    // Average values use the combined totals, so they match a single run.
+    // Like the merged output, the totals are written through a temporary file.
+    double memberCount = (totals.memberCount > 0) ? static_cast<double>(totals.memberCount) : 1.0;
+    string statsFileName = outputFile + COHORT_STATS_EXTENSION;
+    string statsTempFileName = statsFileName + TEMP_FILE_EXTENSION;
+    ofstream statsFile(statsTempFileName, ios::trunc);
+
+    statsFile << fixed << showpoint << setprecision(2);
+    statsFile << "members,fat_loss,maintenance,muscle_gain,avg_daily_calories,"
+        << "avg_protein_grams,avg_carb_grams,avg_fat_grams,"
+        << "sufficient,decent,under_fueling,excess,balanced\n";
+    statsFile << totals.memberCount;
+
+    for (int goal = FAT_LOSS; goal <= MUSCLE_GAIN; ++goal)
+        statsFile << ',' << totals.goalCounts[goal];
+
+    statsFile << ',' << totals.dailyCalories / memberCount
+        << ',' << totals.dailyProteinGrams / memberCount
+        << ',' << totals.dailyCarbGrams / memberCount
+        << ',' << totals.dailyFatGrams / memberCount;
+
+    for (int outcome = 0; outcome < NUTRITION_OUTCOME_COUNT; ++outcome)
+        statsFile << ',' << totals.nutritionOutcomes[outcome];
+
+    statsFile << "\n";
+    statsFile.close();
+
+    if (statsFile.fail() ||
+        !MoveFileExA(statsTempFileName.c_str(), statsFileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        remove(statsTempFileName.c_str());
+        printErrorMessage("Unable to write " + statsFileName);
+        return 1;
+    }
+
+    // The merged output is complete, so the shard files are no longer needed
+    for (int shard = 0; shard < shardCount; ++shard)
+    {
+        string shardOutput = getShardFileName(outputFile, shard, SHARD_OUTPUT_EXTENSION);
+
+        remove((shardOutput + SHARD_CHECKPOINT_EXTENSION).c_str());
+        remove(shardOutput.c_str());
+        remove(getShardFileName(outputFile, shard, SHARD_INPUT_EXTENSION).c_str());
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    cout << fixed << showpoint << setprecision(2);
+    printSummaryLabel("Members: ") << totals.memberCount << "\n";
+    printSummaryLabel("Shards: ") << shardCount << "\n";
+    printSummaryLabel("Shards resumed from checkpoints: ") << resumedCount << "\n";
+    printSummaryLabel("Worker processes started: ") << launchCount << "\n";
+    printSummaryLabel("Average daily calories: ") << totals.dailyCalories / memberCount << "\n";
+    printElapsedSummary(elapsed.count(), static_cast<double>(totals.memberCount), "Members");
+
+    return 0;
+}
+
+
+// ========================== SELF-TEST DEFINITIONS ==========================
+
+// ---------------------------------------------------------------------------
+// Function that counts one self-test check and prints it if it failed.
+// ---------------------------------------------------------------------------
+void checkSelfTest(SelfTestResults& results, bool passed, string description)
+{
+    if (passed)
+    {
+        results.passed++;
+        return;
+    }
+
+    results.failed++;
+    printErrorMessage("Check failed: " + description);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the calorie entry ring, the capped day totals, and
+//     that the threaded pipeline gives the same logs as applying every entry
+//     in order on one thread.
+// ---------------------------------------------------------------------------
+void testCalorieIngestion(SelfTestResults& results)
+{
+    CalorieEntryRing ring;
+    CalorieEntry entry = {};
+    bool ringInOrder = true;
+
+    initCalorieEntryRing(ring, 8);
+
+    // Two laps around the ring, filling it completely each time
+    for (int lap = 0; lap < 2; ++lap)
+    {
+        for (int index = 0; index < 8; ++index)
+        {
+            entry.calories = lap * 8 + index;
+            ringInOrder = tryPushCalorieEntry(ring, entry) && ringInOrder;
+        }
+
+        checkSelfTest(results, !tryPushCalorieEntry(ring, entry), "push into a full ring is refused");
+
+        for (int index = 0; index < 8; ++index)
+            ringInOrder = tryPopCalorieEntry(ring, entry) && entry.calories == lap * 8 + index && ringInOrder;
+
+        checkSelfTest(results, !tryPopCalorieEntry(ring, entry), "pop from an empty ring is refused");
+    }
+
+    checkSelfTest(results, ringInOrder, "ring returns entries in the order they were pushed");
+    checkSelfTest(results, reinterpret_cast<const char*>(&ring.dequeuePosition) -
+        reinterpret_cast<const char*>(&ring.enqueuePosition) >= CACHE_LINE_BYTES,
+        "ring positions are a cache line apart");
+
+    // A day close to the cap stops at the cap instead of overflowing
+    MemberProfile member = {};
+    WeeklyCalorieStats stats;
+
+    member.dailyCaloriesLog[2] = DAY_CALORIES_LIMIT - 10;
+    initWeeklyCalorieStats(member, stats);
+
+    CalorieEntry large = {0, 2, 1000};
+    applyCalorieEntry(member, stats, large);
+    applyCalorieEntry(member, stats, large);
+
+    checkSelfTest(results, member.dailyCaloriesLog[2] == DAY_CALORIES_LIMIT &&
+        stats.highestCalories == DAY_CALORIES_LIMIT && stats.entryCount == 2 &&
+        stats.totalCalories == DAY_CALORIES_LIMIT, "day totals are capped at DAY_CALORIES_LIMIT");
+
+    // Threaded pipeline against applying the same entries in order
+    const int memberCount = 37;
+    vector<MemberProfile> threadedMembers(memberCount);
+    vector<MemberProfile> orderedMembers(memberCount);
+    vector<WeeklyCalorieStats> threadedStats(memberCount);
+    vector<WeeklyCalorieStats> orderedStats(memberCount);
+    vector<CalorieEntry> entries(20000);
+    bool pipelineMatches = true;
+
+    for (int index = 0; index < memberCount; ++index)
+    {
+        for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+            threadedMembers[index].dailyCaloriesLog[day] = (index * 31 + day * 7) % 500;
+
+        orderedMembers[index] = threadedMembers[index];
+        initWeeklyCalorieStats(threadedMembers[index], threadedStats[index]);
+        orderedStats[index] = threadedStats[index];
+    }
+
+    for (size_t index = 0; index < entries.size(); ++index)
+    {
+        entries[index].memberIndex = static_cast<int>(mixCounter(static_cast<unsigned int>(index)) % memberCount);
+        entries[index].day = static_cast<int>(index % NUMBER_OF_DAYS);
+        entries[index].calories = static_cast<int>(index % 900);
+        applyCalorieEntry(orderedMembers[entries[index].memberIndex],
+            orderedStats[entries[index].memberIndex], entries[index]);
+    }
+
+    ingestCalorieEntries(threadedMembers, threadedStats, entries, 3, 2);
+
+    for (int index = 0; index < memberCount; ++index)
+    {
+        pipelineMatches = pipelineMatches &&
+            threadedStats[index].totalCalories == orderedStats[index].totalCalories &&
+            threadedStats[index].highestCalories == orderedStats[index].highestCalories &&
+            threadedStats[index].entryCount == orderedStats[index].entryCount &&
+            equal(threadedMembers[index].dailyCaloriesLog,
+                threadedMembers[index].dailyCaloriesLog + NUMBER_OF_DAYS,
+                orderedMembers[index].dailyCaloriesLog);
+    }
+
+    checkSelfTest(results, pipelineMatches, "threaded ingestion matches applying entries in order");
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the rendered output cache: hits and misses, least
+//     recently used eviction under the byte limit, fingerprints that tell
+//     apart inputs a text format could confuse, and color markers.
+// ---------------------------------------------------------------------------
+void testRenderedOutputCache(SelfTestResults& results)
+{
+    RenderCache cache;
+    initRenderCache(cache, 30);
+
+    storeRenderedOutput(cache, "a", "0123456789");
+    storeRenderedOutput(cache, "b", "0123456789");
+    checkSelfTest(results, findRenderedOutput(cache, "a") != nullptr &&
+        *findRenderedOutput(cache, "a") == "0123456789", "stored text is found by its fingerprint");
+    checkSelfTest(results, findRenderedOutput(cache, "c") == nullptr, "unknown fingerprint misses");
+
+    // "a" was used last, so adding "c" must evict "b"
+    storeRenderedOutput(cache, "c", "0123456789");
+    checkSelfTest(results, findRenderedOutput(cache, "b") == nullptr &&
+        findRenderedOutput(cache, "a") != nullptr && findRenderedOutput(cache, "c") != nullptr &&
+        cache.bytesUsed <= cache.byteLimit, "least recently used entry is evicted at the byte limit");
+
+    storeRenderedOutput(cache, "d", string(40, 'x'));
+    checkSelfTest(results, findRenderedOutput(cache, "d") == nullptr, "text larger than the cache is not stored");
+
+    // Fields are length prefixed and numbers are compared exactly
+    ReportValues first = {};
+    ReportValues second = {};
+    first.name = "ab";
+    first.favoriteProtein = "c";
+    second.name = "a";
+    second.favoriteProtein = "bc";
+
+    checkSelfTest(results, buildReportSectionFingerprint(first, REPORT_FOOTER) !=
+        buildReportSectionFingerprint(second, REPORT_FOOTER), "text fields cannot run into each other");
+
+    second = first;
+    second.weeklyWorkoutHours = 1e-12;
+    checkSelfTest(results, buildReportSectionFingerprint(first, REPORT_INPUTS) !=
+        buildReportSectionFingerprint(second, REPORT_INPUTS) &&
+        buildReportSectionFingerprint(first, REPORT_WEEKLY_MACROS) ==
+        buildReportSectionFingerprint(second, REPORT_WEEKLY_MACROS),
+        "a section's fingerprint changes only with its own inputs");
+
+    // Color markers are applied, not printed
+    ostringstream rendered;
+    ostringstream printed;
+    rendered << "A";
+    setRenderColor(rendered, COLOR_RECIPE);
+    rendered << "B";
+
+    streambuf* originalOutput = cout.rdbuf(printed.rdbuf());
+    printRenderedOutput(rendered.str());
+    cout.rdbuf(originalOutput);
+
+    checkSelfTest(results, printed.str() == "AB", "color markers are removed when printed");
+
+    MemberProfile member;
+    checkSelfTest(results, hasControlCharacters(string("Al") + COLOR_MARKER + "ex") &&
+        !parseMemberProfileLine(string("Al") + COLOR_MARKER + "ex|tofu|2000|3|4|1", member) &&
+        parseMemberProfileLine("Alex|tofu|2000|3|4|1", member),
+        "names with control characters are rejected");
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads a whole file for a self-test check. Returns an empty
+//     string if the file cannot be read.
+// ---------------------------------------------------------------------------
+string readSelfTestFile(string fileName)
+{
+    ifstream inFile(fileName, ios::binary);
+    ostringstream contents;
+
+    contents << inFile.rdbuf();
+    return contents.str();
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the incremental report writer: in place updates and
+//     rebuilds must give the same bytes as writing the report fresh, a
+//     section edited on disk must be rewritten, and lines end in CRLF.
+// ---------------------------------------------------------------------------
+void testIncrementalReport(SelfTestResults& results)
+{
+    const string reportFile = "self_test_report.txt";
+    const string freshFile = "self_test_fresh.txt";
+    const char* memberLines[] = {
+        "Alex|tofu|2000|3|4|1",
+        "Sam|tempeh|2600|4|6|3",
+        "Jordan|lentils|1800|5|3|2"};
+    vector<ReportValues> reports(3);
+    RenderCache renderCache;
+    long long sectionsRewritten = 0;
+
+    initRenderCache(renderCache, RENDER_CACHE_BYTE_LIMIT);
+
+    for (int index = 0; index < 3; ++index)
+    {
+        MemberProfile member;
+        parseMemberProfileLine(memberLines[index], member);
+        buildReportValues(member, reports[index]);
+    }
+
+    // Writes the reports fresh (no index) and compares with the incremental file
+    auto matchesFreshReport = [&]()
+    {
+        long long freshRewritten = 0;
+
+        remove(freshFile.c_str());
+        remove((freshFile + REPORT_INDEX_EXTENSION).c_str());
+
+        return writeReportSections(renderCache, freshFile, reports, freshRewritten) &&
+            readSelfTestFile(reportFile) == readSelfTestFile(freshFile);
+    };
+
+    remove(reportFile.c_str());
+    remove((reportFile + REPORT_INDEX_EXTENSION).c_str());
+
+    checkSelfTest(results, writeReportSections(renderCache, reportFile, reports, sectionsRewritten) &&
+        sectionsRewritten == 3 * REPORT_SECTION_COUNT, "first report writes every section");
+
+    string report = readSelfTestFile(reportFile);
+    checkSelfTest(results, report.find("\r\n") != string::npos &&
+        count(report.begin(), report.end(), '\n') == count(report.begin(), report.end(), '\r'),
+        "report lines end in CRLF");
+
+    writeReportSections(renderCache, reportFile, reports, sectionsRewritten);
+    checkSelfTest(results, sectionsRewritten == 0, "unchanged report rewrites nothing");
+
+    // Same length change (4.00 to 6.00 hours) is written in place
+    reports[0].weeklyWorkoutHours = 6;
+    writeReportSections(renderCache, reportFile, reports, sectionsRewritten);
+    checkSelfTest(results, sectionsRewritten == 2 && matchesFreshReport(),
+        "in place update matches a fresh report");
+
+    // A longer name moves every later section, so the file is rebuilt
+    reports[1].name = "Samantha";
+    writeReportSections(renderCache, reportFile, reports, sectionsRewritten);
+    checkSelfTest(results, sectionsRewritten == 1 && matchesFreshReport(),
+        "rebuilt report matches a fresh report");
+
+    // Edit a section on disk without changing the file size
+    fstream tampered(reportFile, ios::in | ios::out | ios::binary);
+    tampered.seekp(static_cast<streamoff>(readSelfTestFile(reportFile).find("tempeh")));
+    tampered.write("TEMPEH", 6);
+    tampered.close();
+
+    writeReportSections(renderCache, reportFile, reports, sectionsRewritten);
+    checkSelfTest(results, sectionsRewritten == 1 && matchesFreshReport(),
+        "section edited on disk is rewritten");
+
+    remove(reportFile.c_str());
+    remove((reportFile + REPORT_INDEX_EXTENSION).c_str());
+    remove(freshFile.c_str());
+    remove((freshFile + REPORT_INDEX_EXTENSION).c_str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the export formats: CSV quoting, JSON escaping, the
+//     binary record size, binary text cut at a UTF-8 character boundary, and
+//     the streaming member reader stopping at an invalid line.
+// ---------------------------------------------------------------------------
+void testStreamingExport(SelfTestResults& results)
+{
+    unique_ptr<ExportWriter> writer(new ExportWriter);
+    ostringstream out;
+
+    writer->out = &out;
+    writer->used = 0;
+
+    writeExportCsvText(*writer, "plain");
+    writeExportBytes(*writer, ",", 1);
+    writeExportCsvText(*writer, "a,\"b");
+    flushExportWriter(*writer);
+    checkSelfTest(results, out.str() == "plain,\"a,\"\"b\"", "CSV text is quoted only when needed");
+
+    out.str("");
+    writeExportJsonText(*writer, "a\"\\\n");
+    flushExportWriter(*writer);
+    checkSelfTest(results, out.str() == "\"a\\\"\\\\\\u000a\"", "JSON text escapes quotes, backslashes, and control characters");
+
+    // Header plus one record
+    MemberProfile member;
+    ReportValues values;
+
+    parseMemberProfileLine("Alex|tofu|2000|3|4|1", member);
+    buildReportValues(member, values);
+
+    out.str("");
+    writeExportHeader(*writer, EXPORT_BINARY);
+    writeExportRecord(*writer, EXPORT_BINARY, values);
+    flushExportWriter(*writer);
+    checkSelfTest(results, out.str().length() == sizeof(EXPORT_BINARY_MAGIC) + 4 + EXPORT_RECORD_BYTES &&
+        EXPORT_RECORD_BYTES == 128 && out.str().compare(0, 7, "VNWEXP1") == 0,
+        "binary export is the magic, the record size, and 128-byte records");
+
+    // "\xC3\xA9" is a two-byte UTF-8 character that does not fit after 31 bytes
+    string longName = string(EXPORT_NAME_BYTES - 1, 'x') + "\xC3\xA9";
+    string fittingName = string(EXPORT_NAME_BYTES - 2, 'x') + "\xC3\xA9";
+
+    out.str("");
+    writeExportBinaryText(*writer, longName);
+    writeExportBinaryText(*writer, fittingName);
+    flushExportWriter(*writer);
+    checkSelfTest(results, out.str() == string(EXPORT_NAME_BYTES - 1, 'x') + '\0' + fittingName,
+        "binary text is cut before a UTF-8 character that does not fit");
+
+    // The reader hands out members until the invalid line
+    const string membersFile = "self_test_members.txt";
+    MemberProfileReader reader;
+    int membersRead = 0;
+
+    ofstream(membersFile) << "Alex|tofu|2000|3|4|1\n\nSam|tempeh|2600|4|6|3\nbad line\nJo|beans|1800|5|3|2\n";
+
+    // The reader's error message is expected here, so keep it off the console
+    ostringstream expectedErrors;
+    streambuf* originalErrors = cerr.rdbuf(expectedErrors.rdbuf());
+
+    if (openMemberProfiles(membersFile, reader))
+    {
+        while (readMemberProfile(reader, member))
+            ++membersRead;
+    }
+
+    cerr.rdbuf(originalErrors);
+
+    checkSelfTest(results, membersRead == 2 && reader.invalidLine && reader.lineNumber == 4,
+        "member reader stops at the first invalid line");
+
+    reader.file.close();
+    remove(membersFile.c_str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the replay helpers: transcript comparison, report
+//     file name swapping, and a recording surviving a save and load.
+// ---------------------------------------------------------------------------
+void testSessionReplay(SelfTestResults& results)
+{
+    checkSelfTest(results, findFirstDifferentLine("a\nb\nc\n", "a\nb\nc\n") == 0 &&
+        findFirstDifferentLine("a\nb\nc\n", "a\nx\nc\n") == 2 &&
+        findFirstDifferentLine("a\nb\n", "a\nb\nc\n") == 3,
+        "first different line is found, including extra output");
+
+    checkSelfTest(results, normalizeReportFileName("Report successfully generated: C:\\Temp\\replay_report.txt\n",
+        "C:\\Temp\\replay_report.txt") == "Report successfully generated: report.txt\n" &&
+        normalizeReportFileName("report.txt report.txt", REPORT_FILE_NAME) == "report.txt report.txt",
+        "report file names are swapped for report.txt");
+
+    // Input and transcript hold raw bytes, including line breaks and zeros
+    const string recordingFile = "self_test_session.rec";
+    SessionRecording saved;
+    SessionRecording loaded;
+
+    saved.input = "Alex\r\ntofu\n2000\n";
+    saved.transcript = string("What is your name? \n\0Hi Alex!\n", 30);
+
+    checkSelfTest(results, saveSessionRecording(recordingFile, saved) &&
+        loadSessionRecording(recordingFile, loaded) &&
+        loaded.input == saved.input && loaded.transcript == saved.transcript,
+        "recording round trips through its file");
+
+    remove(recordingFile.c_str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the counter-based random numbers (mean, spread, and
+//     keys a small step apart giving unrelated draws) and that the
+//     projection bands do not depend on the thread count.
+// ---------------------------------------------------------------------------
+void testWeightProjection(SelfTestResults& results)
+{
+    const int drawCount = 100000;
+    const unsigned long long key = 1000;
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+
+    for (int counter = 0; counter < drawCount; ++counter)
+    {
+        double draw = counterNormal(key, static_cast<unsigned int>(counter));
+        sum += draw;
+        sumOfSquares += draw * draw;
+    }
+
+    double mean = sum / drawCount;
+    double deviation = sqrt(sumOfSquares / drawCount - mean * mean);
+
+    checkSelfTest(results, fabs(mean) < 0.02 && fabs(deviation - 1.0) < 0.02,
+        "counter draws have mean 0 and standard deviation 1");
+
+    // Adding 2 to the key used to give the same draws one counter later
+    int shiftedMatches = 0;
+    double sameCounterProduct = 0.0;
+
+    for (int counter = 0; counter < 1000; ++counter)
+    {
+        float draw = counterNormal(key, static_cast<unsigned int>(counter));
+
+        if (counterNormal(key + 2, static_cast<unsigned int>(counter)) ==
+            counterNormal(key, static_cast<unsigned int>(counter + 1)))
+            ++shiftedMatches;
+
+        sameCounterProduct += draw * counterNormal(key + 1, static_cast<unsigned int>(counter));
+    }
+
+    checkSelfTest(results, shiftedMatches == 0 && fabs(sameCounterProduct / 1000) < 0.1,
+        "nearby keys give unrelated draws");
+
+    // Same seed, different thread counts
+    const int dailyCaloriesLog[NUMBER_OF_DAYS] = {1800, 2100, 1950, 2200, 2000, 1700, 2300};
+    vector<WeightProjectionBand> oneThread;
+    vector<WeightProjectionBand> fourThreads;
+    bool bandsMatch = true;
+
+    projectWeightTrajectory(2000, 5.0, FAT_LOSS, dailyCaloriesLog, 12, 4, 1000, 1, PROJECTION_SEED, oneThread);
+    projectWeightTrajectory(2000, 5.0, FAT_LOSS, dailyCaloriesLog, 12, 4, 1000, 4, PROJECTION_SEED, fourThreads);
+
+    for (size_t band = 0; band < oneThread.size() && band < fourThreads.size(); ++band)
+    {
+        bandsMatch = bandsMatch && oneThread[band].low == fourThreads[band].low &&
+            oneThread[band].median == fourThreads[band].median && oneThread[band].high == fourThreads[band].high;
+    }
+
+    checkSelfTest(results, oneThread.size() == 3 && fourThreads.size() == 3 && bandsMatch &&
+        oneThread[2].low < oneThread[2].median && oneThread[2].median < oneThread[2].high,
+        "projection bands are the same for any thread count");
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the feedback thresholds, grid line validation, and
+//     the totals a sweep block adds up.
+// ---------------------------------------------------------------------------
+void testPolicySweep(SelfTestResults& results)
+{
+    const MacroPolicy& policy = DEFAULT_MACRO_POLICY;
+
+    checkSelfTest(results, classifyNutrition(policy, CAL_HIGH, ACTIVITY_HIGH) == NUTRITION_SUFFICIENT &&
+        classifyNutrition(policy, CAL_HIGH - 1, ACTIVITY_HIGH) == NUTRITION_DECENT &&
+        classifyNutrition(policy, CAL_MEDIUM, ACTIVITY_MEDIUM) == NUTRITION_DECENT &&
+        classifyNutrition(policy, CAL_LOW - 1, ACTIVITY_MEDIUM - 0.5) == NUTRITION_UNDER_FUELING &&
+        classifyNutrition(policy, CAL_EXCESS + 1, ACTIVITY_MEDIUM - 0.5) == NUTRITION_EXCESS &&
+        classifyNutrition(policy, CAL_MEDIUM, ACTIVITY_MEDIUM - 0.5) == NUTRITION_BALANCED,
+        "nutrition feedback changes at the policy thresholds");
+
+    checkSelfTest(results, classifyMealFrequency(policy, MEALS_PER_WEEK_MEDIUM, ACTIVITY_HIGH) == MEAL_FREQUENCY_EXCELLENT &&
+        classifyMealFrequency(policy, MEALS_PER_WEEK_MEDIUM - 1, ACTIVITY_MEDIUM) == MEAL_FREQUENCY_TOO_LOW &&
+        classifyMealFrequency(policy, MEALS_PER_WEEK_HIGH + 1, ACTIVITY_MEDIUM) == MEAL_FREQUENCY_TOO_HIGH &&
+        classifyMealFrequency(policy, MEALS_PER_WEEK_LOW, ACTIVITY_MEDIUM - 0.5) == MEAL_FREQUENCY_APPROPRIATE,
+        "meal frequency feedback changes at the policy thresholds");
+
+    MacroPolicy parsed;
+
+    checkSelfTest(results, parseMacroPolicyLine("3000|4000|3000|5|3|2500|2200|2000|1800", parsed) &&
+        parsed.carbBasisPoints == 4000 && parsed.calLow == 1800 &&
+        !parseMacroPolicyLine("5000|4000|3000|5|3|2500|2200|2000|1800", parsed) &&
+        !parseMacroPolicyLine("3000|4000|3000|3|5|2500|2200|2000|1800", parsed) &&
+        !parseMacroPolicyLine("3000|4000|3000|5|3|2500|2200|1800|2000", parsed) &&
+        !parseMacroPolicyLine("3000|4000|3000|5|3|2500|2200|2000", parsed),
+        "grid lines with ratios over 100 percent or unordered thresholds are rejected");
+
+    // 2000 calories: 150/200/66 grams; 1700 calories: 127/170/56 grams
+    const SweepMember members[] = {{2000, 2, 5.0}, {1700, 3, 1.0}};
+    vector<MacroPolicy> grid(2, DEFAULT_MACRO_POLICY);
+    vector<SweepTotals> totals(2);
+
+    sweepMemberBlock(grid, members, 2, totals);
+
+    checkSelfTest(results, totals[1].dailyProteinGrams == 277 && totals[1].dailyCarbGrams == 370 &&
+        totals[1].dailyFatGrams == 122 && totals[1].proteinPerMeal == 75 + 42 &&
+        totals[1].nutritionOutcomes[NUTRITION_DECENT] == 1 &&
+        totals[1].nutritionOutcomes[NUTRITION_UNDER_FUELING] == 1 &&
+        totals[0].dailyProteinGrams == totals[1].dailyProteinGrams,
+        "sweep block adds every member's macros and feedback once per grid point");
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks snapshot lookups in a file several mapping windows
+//     long, that the snapshot's report copy survives report rewrites, and
+//     that a member with a damaged report location is not returned.
+// ---------------------------------------------------------------------------
+void testSnapshotLookup(SelfTestResults& results)
+{
+    const string reportFile = "self_test_snapshot_report.txt";
+    const string snapshotFile = "self_test_snapshot.snp";
+    const int memberCount = 2000;
+    const int checkedMembers[] = {0, memberCount / 2, memberCount - 1};
+    vector<MemberProfile> members(memberCount);
+    vector<ReportValues> reports(memberCount);
+    vector<ReportSectionIndex> reportIndex;
+    RenderCache renderCache;
+    MappedSnapshot snapshot;
+    SnapshotMember member;
+    long long sectionsRewritten = 0;
+
+    initRenderCache(renderCache, RENDER_CACHE_BYTE_LIMIT);
+
+    for (int index = 0; index < memberCount; ++index)
+    {
+        parseMemberProfileLine("member" + to_string(index) + "|tofu|" + to_string(1500 + index) + "|3|4|1",
+            members[index]);
+        buildReportValues(members[index], reports[index]);
+    }
+
+    remove(reportFile.c_str());
+    remove((reportFile + REPORT_INDEX_EXTENSION).c_str());
+
+    bool written = writeReportSections(renderCache, reportFile, reports, sectionsRewritten) &&
+        loadReportIndex(reportFile + REPORT_INDEX_EXTENSION, reportIndex) &&
+        writeSnapshot(snapshotFile, members, reports, reportIndex, reportFile);
+    string packedReport = readSelfTestFile(reportFile);
+    bool opened = written && openSnapshot(snapshotFile, snapshot);
+    bool found = opened;
+
+    checkSelfTest(results, opened && snapshot.fileBytes > 4 * SNAPSHOT_VIEW_BYTES,
+        "snapshot spans several mapping windows");
+
+    // Rewriting the report afterwards must not change what the snapshot shows
+    reports[0].name = "renamed";
+    writeReportSections(renderCache, reportFile, reports, sectionsRewritten);
+
+    for (int index : checkedMembers)
+    {
+        const char* start = nullptr;
+
+        found = found && findSnapshotMember(snapshot, members[index].name, member) &&
+            member.dailyCalories == members[index].dailyCalories &&
+            getSnapshotString(snapshot, member.favoriteProtein) == "tofu";
+
+        if (found)
+            start = mapSnapshotRange(snapshot, snapshot.header.reportsOffset + member.reportOffset,
+                static_cast<uint64_t>(member.reportLength));
+
+        found = found && start != nullptr &&
+            string(start, static_cast<size_t>(member.reportLength)) ==
+            packedReport.substr(static_cast<size_t>(member.reportOffset), static_cast<size_t>(member.reportLength));
+    }
+
+    checkSelfTest(results, found && !findSnapshotMember(snapshot, "nobody", member),
+        "members are found by name with their report copy, missing names are not");
+
+    if (opened)
+        closeSnapshot(snapshot);
+
+    // Point the first member's report past the end of the file
+    long long damagedLength = 1LL << 40;
+    fstream damaged(snapshotFile, ios::in | ios::out | ios::binary);
+    damaged.seekp(static_cast<streamoff>(sizeof(SnapshotHeader) + offsetof(SnapshotMember, reportLength)));
+    damaged.write(reinterpret_cast<const char*>(&damagedLength), sizeof(damagedLength));
+    damaged.close();
+
+    opened = openSnapshot(snapshotFile, snapshot);
+    checkSelfTest(results, opened && !findSnapshotMember(snapshot, members[0].name, member) &&
+        findSnapshotMember(snapshot, members[1].name, member),
+        "member with a damaged report location is not returned");
+
+    if (opened)
+        closeSnapshot(snapshot);
+
+    remove(reportFile.c_str());
+    remove((reportFile + REPORT_INDEX_EXTENSION).c_str());
+    remove(snapshotFile.c_str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the integer macro math: known plans, exact rounding
+//     down where floating point would be off by one, and no overflow at the
+//     largest calorie target.
+// ---------------------------------------------------------------------------
+void testMacroMath(SelfTestResults& results)
+{
+    int dailyProteinGrams, dailyCarbGrams, dailyFatGrams;
+    int proteinPerMeal, carbsPerMeal, fatsPerMeal;
+    int weeklyCalories, totalProteinGrams, totalCarbGrams, totalFatGrams;
+
+    // The plan in the committed report.txt
+    calculateMacros(2000, 2, dailyProteinGrams, dailyCarbGrams, dailyFatGrams,
+        proteinPerMeal, carbsPerMeal, fatsPerMeal, weeklyCalories,
+        totalProteinGrams, totalCarbGrams, totalFatGrams);
+
+    checkSelfTest(results, dailyProteinGrams == 150 && dailyCarbGrams == 200 && dailyFatGrams == 66 &&
+        proteinPerMeal == 75 && carbsPerMeal == 100 && fatsPerMeal == 33 && weeklyCalories == 14000 &&
+        totalProteinGrams == 1050 && totalCarbGrams == 1400 && totalFatGrams == 462,
+        "2000 calories over 2 meals gives the known plan");
+
+    ReportValues values = {};
+    values.dailyProteinGrams = dailyProteinGrams;
+    values.dailyCarbGrams = dailyCarbGrams;
+    values.dailyFatGrams = dailyFatGrams;
+    calculateMacroCalories(values);
+
+    checkSelfTest(results, values.dailyProteinCalories == 600 && values.dailyCarbCalories == 800 &&
+        values.dailyFatCalories == 594, "macro calories are grams times calories per gram");
+
+    // 29 percent of 100 is 28.999... in floating point
+    checkSelfTest(results, calculateMacroGrams(100, 2900, 1) == 29 &&
+        calculateMacroGrams(1, PROTEIN_BASIS_POINTS, CALORIES_PER_GRAM_PROTEIN) == 0 &&
+        calculateMacroGrams(INT_MAX, BASIS_POINTS_PER_WHOLE, CALORIES_PER_GRAM_PROTEIN) == INT_MAX / 4,
+        "macro grams are exact, round down, and do not overflow");
+
+    // Every target up to 50000 calories rounds down to the whole gram
+    bool roundsDown = true;
+
+    for (int calories = 1; calories <= 50000 && roundsDown; ++calories)
+    {
+        const int basisPoints[] = {PROTEIN_BASIS_POINTS, CARB_BASIS_POINTS, FAT_BASIS_POINTS};
+        const int caloriesPerGram[] = {CALORIES_PER_GRAM_PROTEIN, CALORIES_PER_GRAM_CARBS, CALORIES_PER_GRAM_FAT};
+
+        for (int macro = 0; macro < 3; ++macro)
+        {
+            long long share = static_cast<long long>(calories) * basisPoints[macro];
+            long long gramCost = static_cast<long long>(BASIS_POINTS_PER_WHOLE) * caloriesPerGram[macro];
+            long long grams = calculateMacroGrams(calories, basisPoints[macro], caloriesPerGram[macro]);
+
+            roundsDown = roundsDown && grams * gramCost <= share && share < (grams + 1) * gramCost;
+        }
+    }
+
+    checkSelfTest(results, roundsDown, "macro grams are the largest whole gram within the share");
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that checks the sharded run helpers: CSV records with quoted line
+//     breaks, the merge order, checkpoints, and the input hashes matching
+//     between the partition and the workers.
+// ---------------------------------------------------------------------------
+void testShardRuns(SelfTestResults& results)
+{
+    istringstream csv("\"Lee\nAnn\",tofu\n\"Jo \"\"J\"\"\",beans\nSam,tempeh");
+    string record;
+    vector<string> records;
+
+    while (readCsvRecord(csv, record))
+        records.push_back(record);
+
+    checkSelfTest(results, records.size() == 3 && records[0] == "\"Lee\nAnn\",tofu" &&
+        records[1] == "\"Jo \"\"J\"\"\",beans" && records[2] == "Sam,tempeh" &&
+        readCsvFirstField(records[0]) == "Lee\nAnn" && readCsvFirstField(records[1]) == "Jo \"J\"",
+        "CSV records keep quoted line breaks and escaped quotes");
+
+    // Two sorted shard outputs merge into one file ordered by name
+    const string outputFile = "self_test_shards.csv";
+    const string firstShard = getShardFileName(outputFile, 0, SHARD_OUTPUT_EXTENSION);
+    const string secondShard = getShardFileName(outputFile, 1, SHARD_OUTPUT_EXTENSION);
+
+    ofstream(firstShard, ios::binary) << "Alex,tofu\n\"Jo\nAnn\",beans\nSam,tempeh\n";
+    ofstream(secondShard, ios::binary) << "\"Bea, B\",seitan\nKai,lentils\n";
+
+    bool merged = mergeShardOutputs(outputFile, 2);
+    string mergedText = readSelfTestFile(outputFile);
+    string header = mergedText.substr(0, mergedText.find('\n') + 1);
+
+    checkSelfTest(results, merged && header.compare(0, 5, "name,") == 0 &&
+        mergedText.substr(header.length()) ==
+        "Alex,tofu\n\"Bea, B\",seitan\n\"Jo\nAnn\",beans\nKai,lentils\nSam,tempeh\n",
+        "shard outputs merge in name order");
+
+    remove(firstShard.c_str());
+    remove(secondShard.c_str());
+    remove(outputFile.c_str());
+
+    // A checkpoint only counts for the same input and shard count
+    const string checkpointFile = firstShard + SHARD_CHECKPOINT_EXTENSION;
+    CohortStats saved = {};
+    CohortStats loaded = {};
+    unsigned long long loadedHash = 0;
+    int loadedShardCount = 0;
+
+    saved.memberCount = 3;
+    saved.goalCounts[MUSCLE_GAIN] = 2;
+    saved.dailyCalories = 6400;
+    saved.nutritionOutcomes[NUTRITION_OUTCOME_COUNT - 1] = 1;
+
+    bool checkpointSaved = saveShardCheckpoint(checkpointFile, 18446744073709551557ULL, 4, saved);
+
+    checkSelfTest(results, checkpointSaved &&
+        loadShardCheckpoint(checkpointFile, loadedHash, loadedShardCount, loaded) &&
+        loadedHash == 18446744073709551557ULL && loadedShardCount == 4 &&
+        loaded.memberCount == 3 && loaded.goalCounts[MUSCLE_GAIN] == 2 && loaded.dailyCalories == 6400 &&
+        loaded.nutritionOutcomes[NUTRITION_OUTCOME_COUNT - 1] == 1,
+        "shard checkpoint survives a save and load");
+
+    checkSelfTest(results, isShardCheckpointCurrent(outputFile, 0, 18446744073709551557ULL, 4, loaded) &&
+        !isShardCheckpointCurrent(outputFile, 0, 18446744073709551556ULL, 4, loaded) &&
+        !isShardCheckpointCurrent(outputFile, 0, 18446744073709551557ULL, 3, loaded) &&
+        !isShardCheckpointCurrent(outputFile, 1, 18446744073709551557ULL, 4, loaded),
+        "shard checkpoint does not match another input or shard count");
+
+    remove(checkpointFile.c_str());
+
+    // Each worker's reader hashes its shard input the same way it was written
+    const string membersFile = "self_test_shard_members.txt";
+    vector<unsigned long long> inputHashes;
+    bool hashesMatch = true;
+
+    ofstream(membersFile) << "Alex|tofu|2000|3|4|1\n\nSam|tempeh|2600|4|6|3\nJo|beans|1800|5|3|2\n";
+
+    bool partitioned = partitionMembers(membersFile, outputFile, 2, inputHashes);
+
+    for (int shard = 0; shard < 2; ++shard)
+    {
+        string shardInput = getShardFileName(outputFile, shard, SHARD_INPUT_EXTENSION);
+        MemberProfileReader reader;
+        MemberProfile member;
+
+        if (partitioned && openMemberProfiles(shardInput, reader))
+        {
+            while (readMemberProfile(reader, member))
+                ;
+
+            hashesMatch = hashesMatch && !reader.invalidLine && !reader.readFailed &&
+                reader.inputHash == inputHashes[shard] &&
+                reader.inputHash == hashFingerprint(readSelfTestFile(shardInput));
+            reader.file.close();
+        }
+        else
+        {
+            hashesMatch = false;
+        }
+
+        remove(shardInput.c_str());
+    }
+
+    checkSelfTest(results, partitioned && hashesMatch,
+        "worker input hashes match the partition's hashes");
+
+    remove(membersFile.c_str());
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --self-test mode. Runs the checks for each batch feature
+//     and prints how many passed. Returns 0 only if every check passed.
+// ---------------------------------------------------------------------------
+int runSelfTestMode()
+{
+    SelfTestResults results = {};
+
+    testCalorieIngestion(results);
+    testRenderedOutputCache(results);
+    testIncrementalReport(results);
+    testStreamingExport(results);
+    testSessionReplay(results);
+    testWeightProjection(results);
+    testPolicySweep(results);
+    testSnapshotLookup(results);
+    testMacroMath(results);
+    testShardRuns(results);
+
+    printSummaryLabel("Checks passed: ") << results.passed << "\n";
+    printSummaryLabel("Checks failed: ") << results.failed << "\n";
+
+    return (results.failed > 0) ? 1 : 0;
+}
+
+
+// ==================== RENDERED OUTPUT CACHE DEFINITIONS ====================
+
+// ---------------------------------------------------------------------------
+// Functions that add one input to a fingerprint as its raw bytes. Copying
+//     the bytes is much cheaper than formatting the value as text, and two
+//     values only give the same bytes if they are exactly equal.
+// ---------------------------------------------------------------------------
+void appendFingerprintInt(string& fingerprint, int value)
+{
+    fingerprint.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+void appendFingerprintDouble(string& fingerprint, double value)
+{
+    fingerprint.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that adds text to a fingerprint after its length, so the end of
+//     one text field can never be read as the start of the next.
+// ---------------------------------------------------------------------------
+void appendFingerprintText(string& fingerprint, const string& text)
+{
+    appendFingerprintInt(fingerprint, static_cast<int>(text.length()));
+    fingerprint += text;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that records a console color change inside rendered text.
+// The color is applied when the text is printed with printRenderedOutput.
+// ---------------------------------------------------------------------------
+void setRenderColor(ostream& out, int color)
+{
+    out << COLOR_MARKER << static_cast<char>(color);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that prints rendered text to the console, switching colors at
+//     each color marker.
+// ---------------------------------------------------------------------------
+void printRenderedOutput(const string& rendered)
+{
+    size_t start = 0;
+    size_t marker = rendered.find(COLOR_MARKER);
+
+    while (marker != string::npos && marker + 1 < rendered.length())
+    {
+        cout.write(rendered.data() + start, marker - start);
+        setConsoleColor(static_cast<unsigned char>(rendered[marker + 1]));
+
+        start = marker + 2;
+        marker = rendered.find(COLOR_MARKER, start);
+    }
+
+    cout.write(rendered.data() + start, rendered.length() - start);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that hashes a fingerprint with 64-bit FNV-1a.
+// ---------------------------------------------------------------------------
+unsigned long long hashFingerprint(const string& fingerprint)
+{
+    return extendFingerprintHash(14695981039346656037ULL, fingerprint);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that hashes a fingerprint a second, unrelated way: a multiply and
+//     shift mix seeded with the length. Report sections are only reused when
+//     both hashes match, so a stale section needs two collisions at once.
+// ---------------------------------------------------------------------------
+unsigned long long checkFingerprint(const string& fingerprint)
+{
+    unsigned long long hash = fingerprint.length();
+
+    for (size_t index = 0; index < fingerprint.length(); ++index)
+    {
+        hash = (hash + static_cast<unsigned char>(fingerprint[index]) + 1) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that adds more text to a hash started by hashFingerprint, so a
+//     file can be hashed as it is written (same result as hashing it whole).
+// ---------------------------------------------------------------------------
+unsigned long long extendFingerprintHash(unsigned long long hash,
+    const string& text)
+{
+    for (size_t index = 0; index < text.length(); ++index)
+    {
+        hash ^= static_cast<unsigned char>(text[index]);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that sets up an empty cache holding at most byteLimit bytes of
+//     fingerprints and rendered text.
+// ---------------------------------------------------------------------------
+void initRenderCache(RenderCache& cache, size_t byteLimit)
+{
+    cache.entries.clear();
+    cache.index.clear();
+    cache.bytesUsed = 0;
+    cache.byteLimit = byteLimit;
+    cache.hits = 0;
+    cache.misses = 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that looks up rendered text by fingerprint.
+// A hit moves the entry to the front so it is evicted last.
+// Returns nullptr on a miss.
+// ---------------------------------------------------------------------------
+const string* findRenderedOutput(RenderCache& cache, const string& fingerprint)
+{
+    auto found = cache.index.find(hashFingerprint(fingerprint));
+
+    if (found == cache.index.end() || found->second->fingerprint != fingerprint)
+    {
+        cache.misses++;
+        return nullptr;
+    }
+
+    cache.hits++;
+    cache.entries.splice(cache.entries.begin(), cache.entries, found->second);
+    return &found->second->rendered;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that adds rendered text to the cache, evicting the least recently
+//     used entries until it fits under the memory cap. Text larger than the
+//     whole cap is not stored.
+// ---------------------------------------------------------------------------
+void storeRenderedOutput(RenderCache& cache, const string& fingerprint,
+    const string& rendered)
+{
+    unsigned long long key = hashFingerprint(fingerprint);
+    size_t entryBytes = fingerprint.length() + rendered.length();
+
+    if (entryBytes > cache.byteLimit)
+        return;
+
+    // Replace any entry with the same key (an older or colliding fingerprint)
+    auto found = cache.index.find(key);
+
+    if (found != cache.index.end())
+    {
+        cache.bytesUsed -= found->second->fingerprint.length() + found->second->rendered.length();
+        cache.entries.erase(found->second);
+        cache.index.erase(found);
+    }
+
+    while (cache.bytesUsed + entryBytes > cache.byteLimit && !cache.entries.empty())
+    {
+        RenderCacheEntry& oldest = cache.entries.back();
+
+        cache.bytesUsed -= oldest.fingerprint.length() + oldest.rendered.length();
+        cache.index.erase(oldest.key);
+        cache.entries.pop_back();
+    }
+
+    RenderCacheEntry entry;
+    entry.key = key;
+    entry.fingerprint = fingerprint;
+    entry.rendered = rendered;
+
+    cache.entries.push_front(entry);
+    cache.index[key] = cache.entries.begin();
+    cache.bytesUsed += entryBytes;
+}
+
+
+// ======================== BATCH MODE DEFINITIONS ===========================
+
+// ---------------------------------------------------------------------------
+// Function that selects a batch mode from the command line arguments.
+// Usage:
+//     program --ingest <members file> <entries file> [producers] [consumers]
+//     program --reports <members file> <packed report file>
+//     program --export <csv|jsonl|binary> <members file> <output file or ->
+//     program --project <members file> <output file> [weeks] [simulations]
+//     program --sweep <members file> <grid file> <output file>
+//     program --snapshot-write <members file> <report file> <snapshot file>
+//     program --snapshot-query <snapshot file> <member name> [more names...]
+//     program --shard <members file> <output file> [shards]
+//     program --record <session file>
+//     program --replay <session file> [more session files...]
+//     program --self-test
+// ---------------------------------------------------------------------------
+int runBatchMode(int argc, char* argv[])
+{
+    string mode = argv[1];
+    int threadCount = static_cast<int>(thread::hardware_concurrency());
+
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    if (mode == "--ingest" && argc >= 4)
+    {
+        int producerCount = (argc > 4) ? atoi(argv[4]) : threadCount;
+        int consumerCount = (argc > 5) ? atoi(argv[5]) : threadCount;
+
+        return runIngestMode(argv[2], argv[3], producerCount, consumerCount);
+    }
+
+    if (mode == "--reports" && argc >= 4)
+        return runReportsMode(argv[2], argv[3]);
+
+    if (mode == "--export" && argc >= 5)
+        return runExportMode(argv[2], argv[3], argv[4]);
+
+    if (mode == "--project" && argc >= 4)
+    {
+        int weeks = (argc > 4) ? atoi(argv[4]) : PROJECTION_WEEKS;
+        int simulations = (argc > 5) ? atoi(argv[5]) : PROJECTION_SIMULATIONS;
+
+        return runProjectMode(argv[2], argv[3], weeks, simulations);
+    }
+
+    if (mode == "--sweep" && argc >= 5)
+        return runSweepMode(argv[2], argv[3], argv[4]);
+
+    if (mode == "--snapshot-write" && argc >= 5)
+        return runSnapshotWriteMode(argv[2], argv[3], argv[4]);
+
+    if (mode == "--snapshot-query" && argc >= 4)
+        return runSnapshotQueryMode(argv[2], argc - 3, argv + 3);
+
+    if (mode == "--shard" && argc >= 4)
+        return runShardMode(argv[2], argv[3], (argc > 4) ? atoi(argv[4]) : threadCount);
+
+    // Started by --shard for each shard; not listed in the usage
+    if (mode == "--shard-worker" && argc >= 5)
+        return runShardWorkerMode(argv[2], argv[3], atoi(argv[4]));
+
+    if (mode == "--record" && argc >= 3)
+        return runRecordMode(argv[2]);
+
+    if (mode == "--replay" && argc >= 3)
+        return runReplayMode(argc - 2, argv + 2);
+
+    if (mode == "--self-test")
+        return runSelfTestMode();
+
+    setConsoleColor(COLOR_ERROR);
+    cout << "Usage:\n"
+        << "  " << argv[0] << " --ingest <members file> <entries file> [producers] [consumers]\n"
+        << "  " << argv[0] << " --reports <members file> <packed report file>\n"
+        << "  " << argv[0] << " --export <csv|jsonl|binary> <members file> <output file or ->\n"
+        << "  " << argv[0] << " --project <members file> <output file> [weeks] [simulations]\n"
+        << "  " << argv[0] << " --sweep <members file> <grid file> <output file>\n"
+        << "  " << argv[0] << " --snapshot-write <members file> <report file> <snapshot file>\n"
+        << "  " << argv[0] << " --snapshot-query <snapshot file> <member name> [more names...]\n"
+        << "  " << argv[0] << " --shard <members file> <output file> [shards]\n"
+        << "  " << argv[0] << " --record <session file>\n"
+        << "  " << argv[0] << " --replay <session file> [more session files...]\n"
+        << "  " << argv[0] << " --self-test\n";
+    setConsoleColor(COLOR_DEFAULT);
+    return 1;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads one member from a line of the members file.
+// Fields are separated by '|':
+//     name|protein|daily calories|meals per day|workout hours|goal(1-3)
+// followed by up to seven optional daily calorie log values.
+// Returns false if any field is missing or out of range, or the name or
+//     protein has control characters.
+// ---------------------------------------------------------------------------
+bool parseMemberProfileLine(const string& line, MemberProfile& member)
+{
+    istringstream fields(line);
+    string field;
+    int goalChoice = 0;
+
+    if (!getline(fields, member.name, PROFILE_FIELD_DELIMITER) || member.name.length() == 0 ||
+        hasControlCharacters(member.name))
+        return false;
+    if (!getline(fields, member.favoriteProtein, PROFILE_FIELD_DELIMITER) || member.favoriteProtein.length() == 0 ||
+        hasControlCharacters(member.favoriteProtein))
+        return false;
+
+    // Numeric fields use the same rules as the interactive validation
+    if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> member.dailyCalories) || member.dailyCalories <= 0)
+        return false;
+    if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> member.mealsPerDay) || member.mealsPerDay <= 0)
+        return false;
+    if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> member.weeklyWorkoutHours) || member.weeklyWorkoutHours < 0.0)
+        return false;
+    if (!getline(fields, field, PROFILE_FIELD_DELIMITER) ||
+        !(istringstream(field) >> goalChoice) || goalChoice < 1 || goalChoice > 3)
+        return false;
+
+    member.goal = static_cast<GoalType>(goalChoice - 1);
+
+    // Log values are optional; missing days start at zero
+    for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+    {
+        member.dailyCaloriesLog[day] = 0;
+
+        if (getline(fields, field, PROFILE_FIELD_DELIMITER) &&
+            (!(istringstream(field) >> member.dailyCaloriesLog[day]) || member.dailyCaloriesLog[day] < 0))
+            return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that opens the members file for reading one member at a time.
+// Returns false (after printing an error) if the file cannot be opened.
+// ---------------------------------------------------------------------------
+bool openMemberProfiles(string fileName, MemberProfileReader& reader)
+{
+    reader.file.open(fileName);
+    reader.fileName = fileName;
+    reader.lineNumber = 0;
+    reader.invalidLine = false;
+    reader.readFailed = false;
+    reader.inputHash = hashFingerprint("");
+
+    if (!reader.file)
+    {
+        printErrorMessage("Unable to open " + fileName);
+        return false;
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that reads the next member from an open members file.
+// Blank lines are skipped. Returns false at the end of the file, or (after
+//     printing an error and setting invalidLine or readFailed) when a line is
+//     invalid or the file cannot be read.
+// Every line read is added to inputHash, so a file whose lines all end in a
+//     line break hashes the same as hashFingerprint of its contents.
+// ---------------------------------------------------------------------------
+bool readMemberProfile(MemberProfileReader& reader, MemberProfile& member)
+{
+    string line;
+
+    while (getline(reader.file, line))
+    {
+        ++reader.lineNumber;
+        reader.inputHash = extendFingerprintHash(reader.inputHash, line + '\n');
+
+        if (line.length() == 0)
+            continue;
+
+        if (!parseMemberProfileLine(line, member))
+        {
+            printErrorMessage("Invalid member on line " + to_string(reader.lineNumber) + " of " + reader.fileName);
+            reader.invalidLine = true;
+            return false;
+        }
+
+        return true;
+    }
+
+    if (reader.file.bad())
+    {
+        printErrorMessage("Unable to read " + reader.fileName);
+        reader.readFailed = true;
+    }
+
+    return false;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that loads every member from the members file.
+// Blank lines are skipped. Returns false if the file cannot be opened or
+//     read, or a line is invalid.
+// ---------------------------------------------------------------------------
+bool loadMemberProfiles(string fileName, vector<MemberProfile>& members)
+{
+    MemberProfileReader reader;
+    MemberProfile member;
+
+    members.clear();
+
+    if (!openMemberProfiles(fileName, reader))
+        return false;
+
+    while (readMemberProfile(reader, member))
+        members.push_back(member);
+
+    return !reader.invalidLine && !reader.readFailed;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that loads calorie entries from the entries file.
+// Each line is: member index (0-based)|day (1-7)|calories
+// Returns false if the file cannot be opened or a line is invalid.
+// ---------------------------------------------------------------------------
+bool loadCalorieEntries(string fileName, int memberCount,
+    vector<CalorieEntry>& entries)
+{
+    ifstream inFile(fileName);
+    string line;
+    int lineNumber = 0;
+
+    if (!inFile)
+    {
+        printErrorMessage("Unable to open " + fileName);
+        return false;
+    }
+
+    entries.clear();
+
+    while (getline(inFile, line))
+    {
+        CalorieEntry entry;
+        char delimiter1 = ' ';
+        char delimiter2 = ' ';
+        ++lineNumber;
+
+        if (line.length() == 0)
+            continue;
+
+        istringstream fields(line);
+        fields >> entry.memberIndex >> delimiter1 >> entry.day >> delimiter2 >> entry.calories;
+
+        if (fields.fail() ||
+            delimiter1 != PROFILE_FIELD_DELIMITER || delimiter2 != PROFILE_FIELD_DELIMITER ||
+            entry.memberIndex < 0 || entry.memberIndex >= memberCount ||
+            entry.day < 1 || entry.day > NUMBER_OF_DAYS || entry.calories < 0)
+        {
+            printErrorMessage("Invalid entry on line " + to_string(lineNumber) + " of " + fileName);
+            return false;
+        }
+
+        entry.day = entry.day - 1;
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that sets up an empty ring. Each slot starts with its own index
+//     as the sequence number, which marks it free for the first lap.
+// ---------------------------------------------------------------------------
+void initCalorieEntryRing(CalorieEntryRing& ring, size_t capacity)
+{
+    ring.cells.reset(new CalorieEntryCell[capacity]);
+    ring.mask = capacity - 1;
+
+    for (size_t slot = 0; slot < capacity; ++slot)
+        ring.cells[slot].sequence.store(slot, memory_order_relaxed);
+
+    ring.enqueuePosition.store(0, memory_order_relaxed);
+    ring.dequeuePosition.store(0, memory_order_relaxed);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that tries to add an entry to the ring without locking.
+// A producer claims a position with compare-exchange, fills the slot, then
+//     publishes it by advancing the slot's sequence number.
+// Returns false if the ring is full.
+// ---------------------------------------------------------------------------
+bool tryPushCalorieEntry(CalorieEntryRing& ring, const CalorieEntry& entry)
+{
+    size_t position = ring.enqueuePosition.load(memory_order_relaxed);
+
+    while (true)
+    {
+        CalorieEntryCell& cell = ring.cells[position & ring.mask];
+        size_t sequence = cell.sequence.load(memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0)
+        {
+            // Slot is free for this lap; try to claim the position
+            if (ring.enqueuePosition.compare_exchange_weak(position, position + 1,
+                memory_order_relaxed))
+            {
+                cell.entry = entry;
+                cell.sequence.store(position + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // Consumer has not freed this slot yet, so the ring is full
+            return false;
+        }
+        else
+        {
+            // Another producer claimed this position first
+            position = ring.enqueuePosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that tries to take the oldest entry from the ring without locking.
+// Returns false if the ring is empty.
+// ---------------------------------------------------------------------------
+bool tryPopCalorieEntry(CalorieEntryRing& ring, CalorieEntry& entry)
+{
+    size_t position = ring.dequeuePosition.load(memory_order_relaxed);
+
+    while (true)
+    {
+        CalorieEntryCell& cell = ring.cells[position & ring.mask];
+        size_t sequence = cell.sequence.load(memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+        if (difference == 0)
+        {
+            if (ring.dequeuePosition.compare_exchange_weak(position, position + 1,
+                memory_order_relaxed))
+            {
+                entry = cell.entry;
+
+                // Mark the slot free for the next lap around the ring
+                cell.sequence.store(position + ring.mask + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = ring.dequeuePosition.load(memory_order_relaxed);
+        }
+    }
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that pushes an entry, waiting while the ring is full.
+// This is the backpressure: producers cannot run ahead of the consumer by
+//     more than the ring capacity, so memory use stays bounded.
+// ---------------------------------------------------------------------------
+void pushCalorieEntry(CalorieEntryRing& ring, const CalorieEntry& entry)
+{
+    while (!tryPushCalorieEntry(ring, entry))
+        this_thread::yield();
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that sets a member's weekly statistics from their current log.
+// ---------------------------------------------------------------------------
+void initWeeklyCalorieStats(const MemberProfile& member,
+    WeeklyCalorieStats& stats)
+{
+    stats.totalCalories = 0;
+    stats.highestCalories = findHighestCalories(member.dailyCaloriesLog, NUMBER_OF_DAYS);
+    stats.entryCount = 0;
+
+    for (int day = 0; day < NUMBER_OF_DAYS; ++day)
+        stats.totalCalories += member.dailyCaloriesLog[day];
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that adds an entry to a member's log and updates the weekly
+//     statistics without rescanning the week. Day totals only grow, so the
+//     highest day can be kept with a single comparison.
+// The day total is added in 64 bits and capped at DAY_CALORIES_LIMIT, so
+//     any number of large entries cannot overflow it.
+// ---------------------------------------------------------------------------
+void applyCalorieEntry(MemberProfile& member, WeeklyCalorieStats& stats,
+    const CalorieEntry& entry)
+{
+    long long dayTotal = static_cast<long long>(member.dailyCaloriesLog[entry.day]) + entry.calories;
+
+    if (dayTotal > DAY_CALORIES_LIMIT)
+        dayTotal = DAY_CALORIES_LIMIT;
+
+    stats.totalCalories += dayTotal - member.dailyCaloriesLog[entry.day];
+    member.dailyCaloriesLog[entry.day] = static_cast<int>(dayTotal);
+    stats.entryCount++;
+
+    if (dayTotal > stats.highestCalories)
+        stats.highestCalories = static_cast<int>(dayTotal);
+}
+
+
+// ---------------------------------------------------------------------------
+// Function that runs the ingestion pipeline.
+// Producer threads split the entries and push them into one ring per
+//     consumer. Entries are routed by member index, so each member belongs to
+//     exactly one consumer and its log and statistics are updated without
+//     locks. Consumers pop entries in batches and apply them.
+// ---------------------------------------------------------------------------
+void ingestCalorieEntries(vector<MemberProfile>& members,
+    vector<WeeklyCalorieStats>& stats, const vector<CalorieEntry>& entries,
+    int producerCount, int consumerCount)
+{
+    if (producerCount < 1)
+        producerCount = 1;
+    if (consumerCount < 1)
+        consumerCount = 1;
+
+    vector<CalorieEntryRing> rings(consumerCount);
+    vector<thread> producers;
+    vector<thread> consumers;
+    atomic<int> producersRunning(producerCount);
+
+    for (int consumer = 0; consumer < consumerCount; ++consumer)
+        initCalorieEntryRing(rings[consumer], INGEST_RING_CAPACITY);
+
+    // Consumer stage: drain its ring in batches until producers finish
+    for (int consumer = 0; consumer < consumerCount; ++consumer)
+    {
+        consumers.push_back(thread([&, consumer]()
+        {
+            CalorieEntryRing& ring = rings[consumer];
+            CalorieEntry batch[INGEST_BATCH_SIZE];
+
+            while (true)
+            {
+                // Read the flag before popping so no late entry is missed
+                bool producersDone = (producersRunning.load(memory_order_acquire) == 0);
+                int batchCount = 0;
+
+                while (batchCount < INGEST_BATCH_SIZE && tryPopCalorieEntry(ring, batch[batchCount]))
+                    ++batchCount;
+
+                for (int index = 0; index < batchCount; ++index)
+                {
+                    const CalorieEntry& entry = batch[index];
+                    applyCalorieEntry(members[entry.memberIndex], stats[entry.memberIndex], entry);
+                }
+
+                if (batchCount == 0)
+                {
+                    if (producersDone)
+                        break;
+                    this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    // Producer stage: each thread pushes its share of the entries
+    for (int producer = 0; producer < producerCount; ++producer)
+    {
+        producers.push_back(thread([&, producer]()
+        {
+            size_t first = entries.size() * producer / producerCount;
+            size_t last = entries.size() * (producer + 1) / producerCount;
+
+            for (size_t index = first; index < last; ++index)
+                pushCalorieEntry(rings[entries[index].memberIndex % consumerCount], entries[index]);
+
+            producersRunning.fetch_sub(1, memory_order_release);
+        }));
+    }
+
+    for (size_t index = 0; index < producers.size(); ++index)
+        producers[index].join();
+    for (size_t index = 0; index < consumers.size(); ++index)
+        consumers[index].join();
+}
+
+
+// ---------------------------------------------------------------------------
+// Function for the --ingest batch mode. Loads members and entries, runs the
+//     pipeline, and prints throughput and a summary of the weekly statistics.
+// ---------------------------------------------------------------------------
+int runIngestMode(string membersFile, string entriesFile,
+    int producerCount, int consumerCount)
+{
+    vector<MemberProfile> members;
+    vector<CalorieEntry> entries;
+
+    // The pipeline needs at least one thread per stage; the summary shows
+    // the counts that are actually used
+    if (producerCount < 1)
+        producerCount = 1;
+    if (consumerCount < 1)
+        consumerCount = 1;
+
+    if (!loadMemberProfiles(membersFile, members) ||
+        !loadCalorieEntries(entriesFile, static_cast<int>(members.size()), entries))
+        return 1;
+
+    vector<WeeklyCalorieStats> stats(members.size());
+
+    for (size_t index = 0; index < members.size(); ++index)
+        initWeeklyCalorieStats(members[index], stats[index]);
+
+    auto startTime = chrono::steady_clock::now();
+    ingestCalorieEntries(members, stats, entries, producerCount, consumerCount);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+
+    long long populationCalories = 0;
+    int populationHighest = 0;
+
+    for (size_t index = 0; index < stats.size(); ++index)
+    {
+        populationCalories += stats[index].totalCalories;
+        if (stats[index].highestCalories > populationHighest)
+            populationHighest = stats[index].highestCalories;
+    }
+
+    printSummaryLabel("Members: ") << members.size() << "\n";
+    printSummaryLabel("Entries ingested: ") << entries.size() << "\n";
+    printSummaryLabel("Producers / consumers: ") << producerCount << " / " << consumerCount << "\n";
+    printElapsedSummary(elapsed.count(), static_cast<double>(entries.size()), "Entries");
+
+    if (members.size() > 0)
+        printSummaryLabel("Average daily calories (all members): ")
+            << static_cast<int>(static_cast<double>(populationCalories) / (members.size() * NUMBER_OF_DAYS)) << "\n";
+
+    printSummaryLabel("Highest daily calories (all members): ") << populationHighest << "\n";
+
+    return 0;
+}